@@ -0,0 +1,212 @@
+#include "Synthetic.h"
+#include "resolver/Format.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+namespace res::synth {
+
+    static constexpr DamageType kDamageTypes[] = {DamageType::Physical, DamageType::Fire, DamageType::Ice, DamageType::Poison};
+
+    struct Rng {
+        std::mt19937 gen;
+
+        explicit Rng(uint32_t seed) : gen(seed) {}
+
+        int Int(int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(gen); }
+        float Float(float lo, float hi) { return std::uniform_real_distribution<float>(lo, hi)(gen); }
+        bool Chance(float p) { return Float(0.f, 1.f) < p; }
+        DamageType Type() { return kDamageTypes[Int(0, 3)]; }
+    };
+
+    static std::string TagName(uint32_t i) { return "tag" + std::to_string(i); }
+
+    static SmallVector<std::string, 3> RandomTags(Rng& rng, uint32_t tagCount, int lo, int hi) {
+        SmallVector<std::string, 3> tags;
+        const int n = rng.Int(lo, hi);
+        for (int i = 0; i < n; ++i) {
+            std::string t = TagName((uint32_t)rng.Int(0, (int)tagCount - 1));
+            if (std::find(tags.begin(), tags.end(), t) == tags.end()) tags.push_back(std::move(t));
+        }
+        return tags;
+    }
+
+    Db MakeContent(const ContentSpec& spec) {
+        if (spec.statuses == 0 || spec.tags == 0) throw std::invalid_argument("Synthetic content needs statuses and tags");
+        Rng rng(spec.seed);
+        Db db;
+
+        for (uint32_t i = 0; i < spec.statuses; ++i) {
+            StatusDef s;
+            s.id = "status" + std::to_string(i);
+            s.tags = RandomTags(rng, spec.tags, 1, 3);
+            s.maxStacks = rng.Int(1, 5);
+            if (rng.Chance(0.3f)) s.statMods.push_back({Stat::Armor, rng.Int(-3, 6)});
+            if (rng.Chance(0.5f)) s.dot = DotDef{rng.Type(), rng.Int(1, 6)};
+
+            const int rules = rng.Int(0, 3);
+            for (int r = 0; r < rules; ++r) {
+                ModifierRule rule;
+                if (rng.Chance(0.6f)) rule.when.incomingDamageType = rng.Type();
+                if (rng.Chance(0.3f)) rule.when.abilityHasTag = TagName((uint32_t)rng.Int(0, (int)spec.tags - 1));
+                if (rng.Chance(0.2f)) rule.when.targetHasStatusTag = TagName((uint32_t)rng.Int(0, (int)spec.tags - 1));
+                rule.modify.addFlat = rng.Chance(0.5f) ? (float)rng.Int(-2, 3) : 0.f;
+                rule.modify.multiplier = rng.Float(0.8f, 1.3f);
+                s.hooks[rng.Chance(0.5f) ? Hook::OnBeforeDealDamage : Hook::OnBeforeTakeDamage].push_back(rule);
+            }
+            db.AddStatus(std::move(s));
+        }
+
+        for (uint32_t i = 0; i < spec.abilities; ++i) {
+            AbilityDef a;
+            a.id = "ability" + std::to_string(i);
+            a.tags = RandomTags(rng, spec.tags, 1, 3);
+            a.targeting.mode = TargetMode::SingleEnemy;
+
+            const int effects = rng.Int(1, 3);
+            for (int k = 0; k < effects; ++k) {
+                const int roll = rng.Int(0, 9);
+                AbilityEffectDef e{roll < 5 ? AbilityEffectDef::Kind::Damage
+                                 : roll < 6 ? AbilityEffectDef::Kind::Heal
+                                 : roll < 9 ? AbilityEffectDef::Kind::ApplyStatus
+                                            : AbilityEffectDef::Kind::RemoveStatusByTag};
+                switch (e.kind) {
+                    case AbilityEffectDef::Kind::Damage:
+                    case AbilityEffectDef::Kind::Heal:
+                        e.damageType = rng.Type();
+                        e.amount = {(float)rng.Int(5, 30), Stat::Power, rng.Float(0.2f, 1.f)};
+                        break;
+                    case AbilityEffectDef::Kind::ApplyStatus:
+                        e.status = (StatusHandle)rng.Int(0, (int)spec.statuses - 1);
+                        e.statusId = db.GetStatus(e.status).id;
+                        e.duration = rng.Int(1, 5);
+                        e.stacks = rng.Int(1, 2);
+                        break;
+                    case AbilityEffectDef::Kind::RemoveStatusByTag:
+                        e.tag = TagName((uint32_t)rng.Int(0, (int)spec.tags - 1));
+                        e.maxRemoved = rng.Int(1, 2);
+                        break;
+                }
+                a.effects.push_back(std::move(e));
+            }
+            db.AddAbility(std::move(a));
+        }
+
+        return db;
+    }
+
+    World MakeWorld(const Db& db, const WorldSpec& spec) {
+        Rng rng(spec.seed);
+        World w;
+        const int statusCount = (int)db.statuses.size();
+
+        for (EntityId id = 1; id <= spec.entities; ++id) {
+            Entity e{id, 1'000'000, rng.Int(0, 5), rng.Int(5, 20), 0, {}};
+            while (e.statuses.size() < std::min<size_t>(spec.statusesPerEntity, (size_t)statusCount)) {
+                const StatusHandle h = (StatusHandle)rng.Int(0, statusCount - 1);
+                const bool dup = std::any_of(e.statuses.begin(), e.statuses.end(),
+                                             [&](const StatusInstance& si) { return si.status == h; });
+                if (dup) continue;
+                const int stacks = rng.Int(1, std::max(1, std::min(spec.maxStacks, db.GetStatus(h).maxStacks)));
+                e.statuses.push_back({h, stacks, rng.Int(1, spec.maxTurns)});
+            }
+            w.Spawn(std::move(e));
+        }
+        return w;
+    }
+
+    std::vector<ResolveRequest> MakeRequests(const Db& db, const World& world, size_t count, uint32_t seed) {
+        if (world.Size() < 2) throw std::invalid_argument("Synthetic requests need at least two entities");
+        Rng rng(seed);
+        std::vector<ResolveRequest> reqs;
+        reqs.reserve(count);
+        const int last = (int)world.Size() - 1;
+
+        for (size_t i = 0; i < count; ++i) {
+            const int caster = rng.Int(0, last);
+            int target = rng.Int(0, last - 1);
+            if (target >= caster) ++target;
+            reqs.push_back({(AbilityHandle)rng.Int(0, (int)db.abilities.size() - 1), world.ids[caster], {world.ids[target]}});
+        }
+        return reqs;
+    }
+
+    static const char* StatName(Stat s) {
+        switch (s) {
+            case Stat::HP: return "HP";
+            case Stat::Armor: return "Armor";
+            case Stat::Power: return "Power";
+        }
+        return "Power";
+    }
+
+    static const char* EffectKindName(AbilityEffectDef::Kind k) {
+        switch (k) {
+            case AbilityEffectDef::Kind::Damage: return "Damage";
+            case AbilityEffectDef::Kind::Heal: return "Heal";
+            case AbilityEffectDef::Kind::ApplyStatus: return "ApplyStatus";
+            case AbilityEffectDef::Kind::RemoveStatusByTag: return "RemoveStatusByTag";
+        }
+        return "Damage";
+    }
+
+    static void WriteJson(const json& root, const std::string& path) {
+        std::ofstream f(path);
+        if (!f) throw std::runtime_error("Failed to open file for writing: " + path);
+        f << root.dump();
+    }
+
+    void WriteContentJson(const Db& db, const std::string& abilitiesPath, const std::string& statusesPath) {
+        json statuses = json::array();
+        for (const auto& s : db.statuses) {
+            json js = {{"id", s.id}, {"tags", s.tags}, {"maxStacks", s.maxStacks}};
+            for (const auto& m : s.statMods) js["statMods"].push_back({{"stat", StatName(m.stat)}, {"add", m.add}});
+            if (s.dot) js["dot"] = {{"damageType", DamageTypeName(s.dot->damageType)}, {"perStackBase", s.dot->perStackBase}};
+            for (const auto& [hook, rules] : s.hooks) {
+                json& jrules = js["hooks"][HookName(hook)];
+                for (const auto& r : rules) {
+                    json jr = {{"modify", {{"addFlat", r.modify.addFlat}, {"multiplier", r.modify.multiplier}}}};
+                    if (r.when.incomingDamageType) jr["when"]["incomingDamageType"] = DamageTypeName(*r.when.incomingDamageType);
+                    if (r.when.abilityHasTag) jr["when"]["abilityHasTag"] = *r.when.abilityHasTag;
+                    if (r.when.targetHasStatusTag) jr["when"]["targetHasStatusTag"] = *r.when.targetHasStatusTag;
+                    jrules.push_back(std::move(jr));
+                }
+            }
+            statuses.push_back(std::move(js));
+        }
+
+        json abilities = json::array();
+        for (const auto& a : db.abilities) {
+            json ja = {{"id", a.id}, {"tags", a.tags}, {"targeting", {{"mode", "SingleEnemy"}}}, {"effects", json::array()}};
+            for (const auto& e : a.effects) {
+                json je = {{"type", EffectKindName(e.kind)}};
+                switch (e.kind) {
+                    case AbilityEffectDef::Kind::Damage:
+                    case AbilityEffectDef::Kind::Heal:
+                        je["damageType"] = DamageTypeName(e.damageType);
+                        je["amount"] = {{"base", e.amount.base}, {"scalesWith", StatName(e.amount.scalesWith)}, {"scale", e.amount.scale}};
+                        break;
+                    case AbilityEffectDef::Kind::ApplyStatus:
+                        je["statusId"] = e.statusId;
+                        je["duration"] = e.duration;
+                        je["stacks"] = e.stacks;
+                        break;
+                    case AbilityEffectDef::Kind::RemoveStatusByTag:
+                        je["tag"] = e.tag;
+                        je["maxRemoved"] = e.maxRemoved;
+                        break;
+                }
+                ja["effects"].push_back(std::move(je));
+            }
+            abilities.push_back(std::move(ja));
+        }
+
+        WriteJson({{"statuses", std::move(statuses)}}, statusesPath);
+        WriteJson({{"abilities", std::move(abilities)}}, abilitiesPath);
+    }
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "resolver/Db.h"
+#include "resolver/Resolver.h"
+#include "resolver/World.h"
+#include <string>
+#include <vector>
+
+// Deterministic generators for benchmark-sized content and worlds.
+
+namespace res::synth {
+
+    struct ContentSpec {
+        uint32_t abilities = 2000;
+        uint32_t statuses = 1000;
+        uint32_t tags = 32;
+        uint32_t seed = 1;
+    };
+
+    struct WorldSpec {
+        uint32_t entities = 1000;
+        uint32_t statusesPerEntity = 4;
+        int maxStacks = 3;          // stack depth of spawned statuses, capped by each def
+        int maxTurns = 8;
+        uint32_t seed = 2;
+    };
+
+    // Statuses get 0-3 hook rules mixing damage type, ability tag and target status tag
+    // conditions, and about half of them tick damage. Abilities are single target with
+    // 1-3 effects drawn from damage, heal, status application and removal by tag.
+    Db MakeContent(const ContentSpec& spec);
+
+    // Entities 1..entities, each with distinct random statuses.
+    World MakeWorld(const Db& db, const WorldSpec& spec);
+
+    // Random single-target requests between distinct entities of the world.
+    std::vector<ResolveRequest> MakeRequests(const Db& db, const World& world, size_t count, uint32_t seed);
+
+    // Writes content in the JSON authoring format read by DbLoader::LoadFromFiles.
+    void WriteContentJson(const Db& db, const std::string& abilitiesPath, const std::string& statusesPath);
+
+}
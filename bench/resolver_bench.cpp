@@ -0,0 +1,385 @@
+#include "Synthetic.h"
+#include "resolver/AllocStats.h"
+#include "resolver/DbLoader.h"
+#include "resolver/Profile.h"
+#include "resolver/Replay.h"
+#include "resolver/ThreadPool.h"
+#include "resolver/TraceSink.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+
+// Micro benchmarks over synthetic content and worlds.
+//
+//   resolver_bench [--quick] [--filter <substring>] [--json <path>]
+//                  [--profile <path>] [--chrome-trace <path>]
+//
+// Each benchmark times samples of a fixed number of operations, so clock overhead stays
+// out of the per-op numbers; percentiles are over per-op times of those samples.
+// --profile and --chrome-trace write the per-phase probe data of the whole run; they
+// need a build configured with -DRESOLVER_PROFILE=ON.
+
+using namespace res;
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    struct Options {
+        bool quick = false;
+        std::string filter;
+        std::string jsonPath;
+        std::string profilePath;
+        std::string chromeTracePath;
+    };
+
+    struct Result {
+        std::string name;
+        uint64_t ops = 0;
+        double nsPerOp = 0;
+        double opsPerSec = 0;
+        double p50 = 0, p90 = 0, p99 = 0;
+        double allocsPerOp = 0, bytesPerOp = 0;
+    };
+
+    double Percentile(const std::vector<double>& sorted, double p) {
+        const size_t i = std::min(sorted.size() - 1, (size_t)(p * (double)(sorted.size() - 1) + 0.5));
+        return sorted[i];
+    }
+
+    class Runner {
+    public:
+        explicit Runner(Options o) : opts(std::move(o)) {}
+
+        // op(i) performs operation i; setup runs untimed before every sample.
+        void Run(const std::string& name, size_t opsPerSample, size_t samples,
+                 const std::function<void(size_t)>& op, const std::function<void()>& setup = {}) {
+            if (!opts.filter.empty() && name.find(opts.filter) == std::string::npos) return;
+            if (opts.quick) samples = std::max<size_t>(3, samples / 10);
+
+            //Warm caches and lazily built tables
+            if (setup) setup();
+            for (size_t i = 0; i < opsPerSample; ++i) op(i);
+
+            std::vector<double> perOp;
+            perOp.reserve(samples);
+            double totalNs = 0;
+            AllocStats allocs;
+            size_t next = 0;
+            for (size_t s = 0; s < samples; ++s) {
+                if (setup) setup();
+                const AllocStats a0 = ThreadAllocations();
+                const auto t0 = Clock::now();
+                for (size_t i = 0; i < opsPerSample; ++i) op(next++);
+                const double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+                allocs += ThreadAllocations() - a0;
+                totalNs += ns;
+                perOp.push_back(ns / (double)opsPerSample);
+            }
+            std::sort(perOp.begin(), perOp.end());
+
+            Result r;
+            r.name = name;
+            r.ops = (uint64_t)(samples * opsPerSample);
+            r.nsPerOp = totalNs / (double)r.ops;
+            r.opsPerSec = r.nsPerOp > 0 ? 1e9 / r.nsPerOp : 0;
+            r.p50 = Percentile(perOp, 0.50);
+            r.p90 = Percentile(perOp, 0.90);
+            r.p99 = Percentile(perOp, 0.99);
+            r.allocsPerOp = (double)allocs.allocations / (double)r.ops;
+            r.bytesPerOp = (double)allocs.bytes / (double)r.ops;
+            results.push_back(r);
+
+            std::printf("%-32s %12.1f ns/op %14.0f ops/s   p50 %10.1f  p90 %10.1f  p99 %10.1f  %8.2f allocs/op\n",
+                        r.name.c_str(), r.nsPerOp, r.opsPerSec, r.p50, r.p90, r.p99, r.allocsPerOp);
+        }
+
+        void WriteJson() const {
+            if (opts.jsonPath.empty()) return;
+            json out;
+#ifdef NDEBUG
+            out["assertions"] = false;
+#else
+            out["assertions"] = true;
+#endif
+            out["quick"] = opts.quick;
+            out["benchmarks"] = json::array();
+            for (const auto& r : results) {
+                out["benchmarks"].push_back({{"name", r.name}, {"ops", r.ops}, {"ns_per_op", r.nsPerOp},
+                                             {"ops_per_sec", r.opsPerSec}, {"p50_ns", r.p50}, {"p90_ns", r.p90},
+                                             {"p99_ns", r.p99}, {"allocs_per_op", r.allocsPerOp},
+                                             {"bytes_per_op", r.bytesPerOp}});
+            }
+            std::ofstream f(opts.jsonPath);
+            if (!f) throw std::runtime_error("Failed to open file for writing: " + opts.jsonPath);
+            f << out.dump(2) << "\n";
+        }
+
+        void WriteProfile() const {
+            auto write = [](const std::string& path, void (*writer)(std::ostream&)) {
+                if (path.empty()) return;
+                std::ofstream f(path);
+                if (!f) throw std::runtime_error("Failed to open file for writing: " + path);
+                writer(f);
+            };
+            write(opts.profilePath, WriteProfileJson);
+            write(opts.chromeTracePath, WriteChromeTrace);
+        }
+
+        const Options opts;
+
+    private:
+        std::vector<Result> results;
+    };
+
+    void ResolveBenchmarks(Runner& run, const Db& db, const World& base) {
+        const Resolver resolver(db);
+        const auto reqs = synth::MakeRequests(db, base, 4096, 7);
+
+        for (TraceLevel level : {TraceLevel::Off, TraceLevel::Summary, TraceLevel::Full}) {
+            const char* suffix = level == TraceLevel::Off ? "off" : level == TraceLevel::Summary ? "summary" : "full";
+            World w = base;
+            ResolutionTrace trace;
+            trace.level = level;
+            run.Run(std::string("resolve/trace_") + suffix, 256, 400, [&](size_t i) {
+                trace.Clear();
+                resolver.Resolve(w, reqs[i % reqs.size()], trace);
+            }, [&] {
+                //Abilities keep applying statuses; tick outside the timed region so they also expire
+                ResolutionTrace tick;
+                tick.level = TraceLevel::Off;
+                w.TickTurnStart(db, tick);
+            });
+        }
+
+        //Full traces rendered as they are recorded, into a sink that drops the text
+        World w = base;
+        NullTraceSink null;
+        ResolutionTrace streamed;
+        streamed.sink = &null;
+        run.Run("resolve/trace_full_streamed", 256, 400, [&](size_t i) {
+            resolver.Resolve(w, reqs[i % reqs.size()], streamed);
+        }, [&] {
+            ResolutionTrace tick;
+            tick.level = TraceLevel::Off;
+            w.TickTurnStart(db, tick);
+        });
+    }
+
+    void AreaBenchmarks(Runner& run, const Db& base, const World& world) {
+        //One Physical hit on 40 targets, as an area ability and as 40 single-target resolves
+        Db db = base;
+        AbilityDef cleave;
+        cleave.id = "bench_cleave";
+        cleave.tags = {"tag0"};
+        cleave.targeting.mode = TargetMode::AllEnemies;
+        AbilityEffectDef hit{AbilityEffectDef::Kind::Damage};
+        hit.damageType = DamageType::Physical;
+        hit.amount = {12.f, Stat::Power, 0.5f};
+        cleave.effects.push_back(hit);
+        AbilityDef single = cleave;
+        single.id = "bench_cleave_one";
+        single.targeting.mode = TargetMode::SingleEnemy;
+        const AbilityHandle area = db.AddAbility(std::move(cleave));
+        const AbilityHandle one = db.AddAbility(std::move(single));
+
+        const Resolver resolver(db);
+        ResolveRequest req{area, world.ids[0], {}};
+        for (uint32_t row = 1; row <= 40; ++row) req.targets.push_back(world.ids[row]);
+        World w = world;
+        ResolutionTrace trace;
+        trace.level = TraceLevel::Off;
+
+        run.Run("area/cleave40", 64, 200, [&](size_t) {
+            trace.Clear();
+            resolver.Resolve(w, req, trace);
+        });
+        std::vector<ResolveRequest> singles;
+        for (EntityId t : req.targets) singles.push_back({one, req.caster, {t}});
+        run.Run("area/cleave40_separate", 64, 200, [&](size_t) {
+            for (const auto& r : singles) {
+                trace.Clear();
+                resolver.Resolve(w, r, trace);
+            }
+        });
+    }
+
+    void ForkBenchmarks(Runner& run, const Db& db, const World& base) {
+        const Resolver resolver(db);
+        const auto reqs = synth::MakeRequests(db, base, 4096, 13);
+        World w = base;
+        ResolutionTrace trace;
+        trace.level = TraceLevel::Off;
+
+        //One lookahead branch: fork, resolve a few plies, throw it away
+        run.Run("fork/resolve4_discard", 256, 200, [&](size_t i) {
+            auto fork = w.Fork();
+            for (size_t k = 0; k < 4; ++k) resolver.Resolve(w, reqs[(i * 4 + k) % reqs.size()], trace);
+        });
+    }
+
+    void TickBenchmarks(Runner& run, const Db& db, const World& base) {
+        World w;
+        ResolutionTrace trace;
+        trace.level = TraceLevel::Off;
+        size_t ticks = 0;
+        run.Run("tick_turn_start/trace_off", 1, 200, [&](size_t) {
+            w.TickTurnStart(db, trace);
+            ++ticks;
+        }, [&] {
+            //Restart from the full world before every status has expired
+            if (ticks % 4 == 0) w = base;
+        });
+
+        ThreadPool pool;
+        ticks = 0;
+        run.Run("tick_turn_start/parallel", 1, 200, [&](size_t) {
+            w.TickTurnStart(db, trace, &pool);
+            ++ticks;
+        }, [&] {
+            if (ticks % 4 == 0) w = base;
+        });
+
+        //A large mostly idle world: long buffs everywhere, a DoT on one entity in fifty
+        StatusHandle dot = 0, buff = 0;
+        while (!db.hasDot[dot]) ++dot;
+        while (db.hasDot[buff]) ++buff;
+        World idle;
+        for (EntityId id = 1; id <= 20000; ++id) {
+            Entity e{id, 1'000'000, 0, 10, 0, {{buff, 1, 1000 + (int)(id % 500)}}};
+            if (id % 50 == 0) e.statuses.push_back({dot, 1, 1000});
+            idle.Spawn(std::move(e));
+        }
+        World sparse = idle;
+        run.Run("tick_turn_start/sparse20k", 1, 200, [&](size_t) {
+            sparse.TickTurnStart(db, trace);
+        }, [&] {
+            if (sparse.turn >= 900) sparse = idle;
+        });
+    }
+
+    void StatusBenchmarks(Runner& run, const Db& db, const World& base) {
+        std::mt19937 gen(11);
+        std::vector<std::pair<uint32_t, StatusHandle>> adds(4096);
+        for (auto& [row, status] : adds) {
+            row = (uint32_t)(gen() % base.Size());
+            status = (StatusHandle)(gen() % db.statuses.size());
+        }
+        std::vector<std::pair<uint32_t, TagMask>> removes(4096);
+        for (auto& [row, tag] : removes) {
+            row = (uint32_t)(gen() % base.Size());
+            tag = TagBit((uint32_t)(gen() % db.tagNames.size()));
+        }
+
+        World w = base;
+        run.Run("add_status", 1024, 200, [&](size_t i) {
+            const auto& [row, status] = adds[i % adds.size()];
+            w.AddStatus(db, w.Row(row), status, 3, 1);
+        }, [&] { w = base; });
+
+        run.Run("remove_statuses_by_tag", 1024, 200, [&](size_t i) {
+            const auto& [row, tag] = removes[i % removes.size()];
+            w.RemoveStatusesByTag(db, w.Row(row), tag, 1);
+        }, [&] { w = base; });
+    }
+
+    void ReplayBenchmarks(Runner& run, const Db& db, const World& base) {
+        namespace fs = std::filesystem;
+        const std::string log = (fs::temp_directory_path() / "resolver_bench_replay.log").string();
+        const Resolver resolver(db);
+        const auto reqs = synth::MakeRequests(db, base, 4096, 17);
+        constexpr size_t kOps = 4096 + 64;
+        {
+            World w = base;
+            ReplayRecorder recorder(log, w);
+            w.recorder = &recorder;
+            ResolutionTrace trace;
+            trace.level = TraceLevel::Off;
+            for (size_t i = 0; i < reqs.size(); ++i) {
+                trace.Clear();
+                resolver.Resolve(w, reqs[i], trace);
+                if (i % 64 == 63) w.TickTurnStart(db, trace);
+            }
+            w.recorder = nullptr;
+        }
+
+        //One op is one log entry; the whole log is replayed per sample
+        uint64_t mismatches = 0;
+        run.Run("replay/trace_off", kOps, 10, [&](size_t i) {
+            if (i % kOps == 0) mismatches += Replay(db, log).mismatches;
+        });
+        if (mismatches != 0) std::printf("replay diverged from the recording\n");
+        fs::remove(log);
+    }
+
+    void LoadBenchmarks(Runner& run, const Db& db) {
+        namespace fs = std::filesystem;
+        const fs::path dir = fs::temp_directory_path() / "resolver_bench_content";
+        fs::create_directories(dir);
+        const std::string abilities = (dir / "abilities.json").string();
+        const std::string statuses = (dir / "statuses.json").string();
+        const std::string snapshot = (dir / "content.resdb").string();
+        synth::WriteContentJson(db, abilities, statuses);
+        DbLoader::WriteSnapshot(db, snapshot);
+
+        size_t sink = 0;
+        run.Run("load_from_files", 1, 20, [&](size_t) {
+            sink += DbLoader::LoadFromFiles(abilities, statuses).abilities.size();
+        });
+        run.Run("load_from_snapshot", 1, 20, [&](size_t) {
+            sink += DbLoader::LoadFromSnapshot(snapshot).abilities.size();
+        });
+        if (sink == 0) std::printf("(no content loaded)\n");
+        fs::remove_all(dir);
+    }
+
+}
+
+int main(int argc, char** argv) {
+    Options opts;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--quick")) opts.quick = true;
+        else if (!std::strcmp(argv[i], "--filter") && i + 1 < argc) opts.filter = argv[++i];
+        else if (!std::strcmp(argv[i], "--json") && i + 1 < argc) opts.jsonPath = argv[++i];
+        else if (!std::strcmp(argv[i], "--profile") && i + 1 < argc) opts.profilePath = argv[++i];
+        else if (!std::strcmp(argv[i], "--chrome-trace") && i + 1 < argc) opts.chromeTracePath = argv[++i];
+        else {
+            std::cerr << "usage: resolver_bench [--quick] [--filter <substring>] [--json <path>]\n"
+                         "                      [--profile <path>] [--chrome-trace <path>]\n";
+            return 2;
+        }
+    }
+
+    try {
+        Runner run(opts);
+#ifndef NDEBUG
+        std::printf("warning: assertions are enabled; configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers\n");
+#endif
+        if (kProfilingEnabled) std::printf("note: profiling probes are compiled in and add to every timing\n");
+        else if (!opts.profilePath.empty() || !opts.chromeTracePath.empty())
+            std::printf("warning: profiling probes are compiled out; configure with -DRESOLVER_PROFILE=ON to record them\n");
+        const Db db = synth::MakeContent({});
+        const World world = synth::MakeWorld(db, {});
+
+        ResolveBenchmarks(run, db, world);
+        AreaBenchmarks(run, db, world);
+        ForkBenchmarks(run, db, world);
+        TickBenchmarks(run, db, world);
+        StatusBenchmarks(run, db, world);
+        ReplayBenchmarks(run, db, world);
+        LoadBenchmarks(run, db);
+
+        run.WriteJson();
+        run.WriteProfile();
+    } catch (const std::exception& e) {
+        std::cerr << "resolver_bench: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+
+namespace res {
+
+    struct AllocStats {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+
+        AllocStats operator-(const AllocStats& o) const { return {allocations - o.allocations, bytes - o.bytes}; }
+        AllocStats& operator+=(const AllocStats& o) {
+            allocations += o.allocations;
+            bytes += o.bytes;
+            return *this;
+        }
+    };
+
+    // Heap allocations made so far by the calling thread. Counting is done by the replacement
+    // operator new in the resolver_alloc_hooks library; without it linked in, every count is 0.
+    AllocStats ThreadAllocations();
+    bool AllocationCountingEnabled();
+
+    struct AllocCallStats {
+        AllocStats total;
+        uint64_t calls = 0;
+    };
+
+    // Allocations made inside Resolver::Resolve (per request, batches included) and
+    // World::TickTurnStart on the calling thread.
+    struct AllocProfile {
+        AllocCallStats resolve;
+        AllocCallStats tick;
+    };
+
+    AllocProfile& ThreadAllocProfile();
+
+    // Charges the allocations made during its lifetime to one call of an AllocCallStats.
+    class AllocScope {
+    public:
+        explicit AllocScope(AllocCallStats& s) : stats(s), start(ThreadAllocations()) {}
+        ~AllocScope() {
+            stats.total += ThreadAllocations() - start;
+            stats.calls += 1;
+        }
+
+        AllocScope(const AllocScope&) = delete;
+        AllocScope& operator=(const AllocScope&) = delete;
+
+    private:
+        AllocCallStats& stats;
+        AllocStats start;
+    };
+
+    // Allocations made by the calling thread while running f.
+    template <typename F>
+    AllocStats CountAllocations(F&& f) {
+        const AllocStats before = ThreadAllocations();
+        f();
+        return ThreadAllocations() - before;
+    }
+
+    namespace detail {
+        void CountAllocation(uint64_t bytes);
+        void EnableAllocationCounting();
+    }
+
+}
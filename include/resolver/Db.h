@@ -1,15 +1,116 @@
 #pragma once
 #include "Types.h"
+#include <algorithm>
+#include <climits>
+#include <span>
 #include <unordered_map>
 
 namespace res {
 
+    // Identity of one Db object. Every construction, copy and content change takes a fresh
+    // value, so caches keyed on it cannot confuse a Db with one later built at the same address.
+    struct DbStamp {
+        uint64_t value = Next();
+
+        DbStamp() = default;
+        DbStamp(const DbStamp&) : value(Next()) {}
+        DbStamp& operator=(const DbStamp&) { value = Next(); return *this; }
+        void Renew() { value = Next(); }
+
+        static uint64_t Next();
+    };
+
+    // Ability effects lowered for the resolver: operands are resolved to handles and masks
+    // and nothing carries the authoring strings, so an ability's ops sit in one small block.
+    enum class EffectOpCode : uint8_t { Damage, Heal, ApplyStatus, RemoveByTag };
+
+    struct EffectOp {
+        EffectOpCode code = EffectOpCode::Damage;
+        DamageType damageType = DamageType::Physical;   // Damage, Heal
+        Stat scalesWith = Stat::Power;                  // Damage, Heal
+        float base = 0.f;                               // Damage, Heal
+        float scale = 0.f;
+        StatusHandle status = 0;                        // ApplyStatus
+        int duration = 0;
+        int stacks = 0;
+        TagMask tagMask = 0;                            // RemoveByTag
+        int maxRemoved = 0;
+        uint32_t tag = 0;       // RemoveByTag: index in tagNames, which traces render by
+    };
+
+    // Targeting reduced to a target count range and caster checks, plus the ability's ops.
+    struct AbilityCode {
+        uint32_t firstOp = 0;
+        uint32_t opCount = 0;
+        uint32_t applyStatusOps = 0;
+        uint32_t minTargets = 0;
+        uint32_t maxTargets = UINT32_MAX;
+        bool casterOnly = false;        // every target must be the caster
+        bool excludeCaster = false;     // no target may be the caster
+        bool area = false;              // runs effect by effect across all targets
+        TargetMode mode = TargetMode::SingleEnemy;
+        TagMask tagMask = 0;
+    };
+
     struct Db {
-        std::unordered_map<std::string, AbilityDef> abilities;
-        std::unordered_map<std::string, StatusDef> statuses;
+        // Defs are stored contiguously and addressed by handle; the index maps are
+        // only used to intern ids at load/setup time, never during resolution.
+        std::vector<AbilityDef> abilities;
+        std::vector<StatusDef> statuses;
+        std::unordered_map<std::string, AbilityHandle> abilityIndex;
+        std::unordered_map<std::string, StatusHandle> statusIndex;
+
+        // Tag registry: every tag named by a def, a hook condition or a status removal is
+        // interned when the def is added, so resolution only ever compares TagMasks.
+        std::vector<std::string> tagNames;
+        std::unordered_map<std::string, uint32_t> tagIndex;
+
+        // Per-stack DoT damage by StatusHandle (0 for statuses without a DoT), read by the turn tick.
+        std::vector<int> dotPerStack;
+        // 1 for statuses with a DoT, even a zero one; the tick visits rows holding any of them.
+        std::vector<uint8_t> hasDot;
+
+        // Abilities lowered by AddAbility, indexed by AbilityHandle. Resolution reads only
+        // these, so defs must not be edited in place once added; use ReplaceAbility.
+        std::vector<AbilityCode> abilityCode;
+        std::vector<EffectOp> abilityOps;
+        uint32_t opGarbage = 0;     // abilityOps slots no longer owned by any ability
+
+        DbStamp stamp;
+
+        AbilityHandle AddAbility(AbilityDef def);
+        // Swaps in a new def for an existing ability, keeping its handle; the id must match.
+        void ReplaceAbility(AbilityHandle h, AbilityDef def);
+        StatusHandle AddStatus(StatusDef def);
+
+        // Interns a tag, assigning the next index; the mask is TagBit of that index, so
+        // tags past kMaskedTags all share kOverflowTag.
+        TagMask InternTag(const std::string& tag);
+        TagMask InternTags(std::span<const std::string> tags);
+        // Bit of an already interned tag, 0 for tags no def uses.
+        TagMask TagMaskOf(const std::string& tag) const;
+        // Exact test of a def's tags (AbilityDef or StatusDef) for one tag; only tags past
+        // kMaskedTags cost a name comparison.
+        template <typename Def>
+        static bool DefHasTag(const Def& def, TagMask tag, const std::string& name) {
+            if (!(def.tagMask & tag)) return false;
+            return tag != kOverflowTag || std::find(def.tags.begin(), def.tags.end(), name) != def.tags.end();
+        }
+
+        AbilityHandle FindAbility(const std::string& id) const;
+        StatusHandle FindStatus(const std::string& id) const;
+        bool HasStatus(const std::string& id) const { return statusIndex.contains(id); }
+
+        const AbilityDef& GetAbility(AbilityHandle h) const;
+        const AbilityCode& GetAbilityCode(AbilityHandle h) const;
+        std::span<const EffectOp> Ops(const AbilityCode& code) const { return {abilityOps.data() + code.firstOp, code.opCount}; }
+        // Repacks abilityOps in handle order, dropping blocks left behind by ReplaceAbility.
+        // ReplaceAbility calls it once at least half the table is garbage.
+        void CompactOps();
+        const StatusDef &GetStatus(StatusHandle h) const;
 
-        const AbilityDef& GetAbility(const std::string& id) const;
-        const StatusDef &GetStatus(const std::string &id) const;
+    private:
+        void Lower(AbilityHandle h, AbilityDef& def);
     };
 
-}
\ No newline at end of file
+}
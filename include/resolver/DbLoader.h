@@ -4,9 +4,22 @@
 
 namespace res {
 
+    class ThreadPool;
+
     struct DbLoader {
+        // JSON files are streamed, not read into a DOM. With a pool the files are parsed
+        // concurrently; ApplyStatus references are checked once every file is in.
         static Db LoadFromFiles(const std::string& abilitiesPath,
-                                const std::string& statusesPath);
+                                const std::string& statusesPath,
+                                ThreadPool* pool = nullptr);
+        // Loads every *.json shard in a directory, in file name order. Each shard may hold a
+        // "statuses" array, an "abilities" array or both, and may reference statuses from any shard.
+        static Db LoadFromDirectory(const std::string& dir, ThreadPool* pool = nullptr);
+
+        // Binary snapshot of a loaded Db (see DbSnapshot.h). Loading maps the file, checks
+        // its magic, version and checksum, and builds the Db straight from the packed tables.
+        static void WriteSnapshot(const Db& db, const std::string& path);
+        static Db LoadFromSnapshot(const std::string& path);
     };
     
 }
\ No newline at end of file
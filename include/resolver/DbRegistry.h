@@ -0,0 +1,55 @@
+#pragma once
+#include "Db.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace res {
+
+    // Publishes successive Db versions for hot reload. Readers pin the current version with
+    // Acquire, which never takes a lock; a pinned Db stays alive until the last pin is
+    // dropped, however many versions are published meanwhile. Publishers are serialized
+    // and only wait for readers that are inside Acquire at the moment of the swap.
+    //
+    // Worlds, replay logs and traces hold Ability and Status handles across versions, so a
+    // published Db must keep every handle of the current one naming the same id: content
+    // may be changed in place and appended, but never removed or reordered.
+    class DbRegistry {
+    public:
+        struct Snapshot {
+            std::shared_ptr<const Db> db;
+            uint64_t version = 0;
+
+            const Db& operator*() const { return *db; }
+            const Db* operator->() const { return db.get(); }
+        };
+
+        explicit DbRegistry(Db initial);
+        ~DbRegistry();
+
+        DbRegistry(const DbRegistry&) = delete;
+        DbRegistry& operator=(const DbRegistry&) = delete;
+
+        Snapshot Acquire() const;
+        // Makes next the current Db and returns its version. In-flight pins keep the old one.
+        // Throws std::runtime_error, leaving the current Db in place, if next renumbers or
+        // drops an ability or status of the current one.
+        uint64_t Publish(Db next);
+        uint64_t Version() const;
+
+    private:
+        struct Node {
+            std::shared_ptr<const Db> db;
+            uint64_t version;
+        };
+
+        std::atomic<Node*> current;
+        // Readers announce themselves on the counter of the current epoch while they copy
+        // out of a node; a publisher flips the epoch and drains the old counter before
+        // freeing the node it replaced.
+        std::atomic<uint64_t> epoch{0};
+        mutable std::atomic<uint32_t> readers[2] = {0, 0};
+        std::mutex publishMutex;
+    };
+
+}
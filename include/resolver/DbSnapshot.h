@@ -0,0 +1,107 @@
+#pragma once
+#include <cstdint>
+
+// On-disk layout of a packed Db, written by DbLoader::WriteSnapshot (and the resolver_pack
+// tool) and read by DbLoader::LoadFromSnapshot. Every record is fixed size, 4-byte aligned
+// and little-endian. References between tables are element indices and strings are
+// (offset, length) pairs into the string table, so the file is position independent and
+// can be mapped anywhere; the loader turns section offsets into pointers after validating them.
+
+namespace res::snapshot {
+
+    inline constexpr char kMagic[8] = {'R', 'E', 'S', 'D', 'B', 'P', 'K', '\0'};
+    // Bump whenever any record below changes shape or meaning.
+    inline constexpr uint32_t kVersion = 2;
+
+    enum class Section : uint32_t {
+        Strings,    // raw bytes, not terminated
+        TagNames,   // StrRef per interned tag, in bit order
+        TagRefs,    // StrRef lists referenced by AbilityRec/StatusRec tag ranges
+        Statuses,   // StatusRec in handle order
+        StatMods,   // StatModRec
+        Rules,      // RuleRec
+        Abilities,  // AbilityRec in handle order
+        Effects,    // EffectRec
+        Count
+    };
+
+    struct StrRef {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    struct Range {
+        uint32_t begin;
+        uint32_t count;
+    };
+
+    struct SectionEntry {
+        uint64_t offset;    // from the start of the file
+        uint64_t count;     // number of records (bytes for Strings)
+    };
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;
+        uint64_t fileSize;
+        uint64_t checksum;  // Checksum() of every byte after the header
+        SectionEntry sections[(uint32_t)Section::Count];
+    };
+
+    struct StatModRec {
+        uint32_t stat;
+        int32_t add;
+    };
+
+    inline constexpr uint32_t kRuleHasDamageType = 1u << 0;
+    inline constexpr uint32_t kRuleHasAbilityTag = 1u << 1;
+    inline constexpr uint32_t kRuleHasTargetStatusTag = 1u << 2;
+
+    struct RuleRec {
+        uint32_t hook;
+        uint32_t flags;
+        uint32_t damageType;
+        StrRef abilityTag;
+        StrRef targetStatusTag;
+        float addFlat;
+        float multiplier;
+    };
+
+    struct StatusRec {
+        StrRef id;
+        Range tags;
+        int32_t maxStacks;
+        Range statMods;
+        Range rules;        // grouped by hook, in Hook order
+        uint32_t hasDot;
+        uint32_t dotDamageType;
+        int32_t dotPerStackBase;
+    };
+
+    struct EffectRec {
+        uint32_t kind;
+        uint32_t damageType;
+        float amountBase;
+        uint32_t amountScalesWith;
+        float amountScale;
+        StrRef statusId;
+        uint32_t status;
+        int32_t duration;
+        int32_t stacks;
+        StrRef tag;
+        int32_t maxRemoved;
+    };
+
+    struct AbilityRec {
+        StrRef id;
+        Range tags;
+        uint32_t targetMode;
+        int32_t maxTargets;
+        Range effects;
+    };
+
+    // 64-bit FNV-1a over 8-byte words, then the trailing bytes.
+    uint64_t Checksum(const unsigned char* data, uint64_t size);
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace res {
+
+    // Hierarchical timing wheel keyed by turn number, holding at most one wakeup per world slot.
+    // The near level has one bucket per turn for the next 64 turns, the mid level one bucket per
+    // 64 turns for the next 4096, and anything later waits in an overflow list; entries move
+    // down a level as their bucket comes up, so each turn only looks at what is due. Buckets
+    // are intrusive lists threaded through per-slot nodes, so scheduling, cancelling and
+    // collecting never allocate once the slots exist.
+    class ExpiryWheel {
+    public:
+        static constexpr int kBuckets = 64;
+        static constexpr int kNone = INT_MAX;
+
+        ExpiryWheel() { heads.fill(kNil); }
+
+        // Makes room for slots [0, n).
+        void Resize(size_t n);
+
+        // Turn the slot is scheduled for, kNone when unscheduled.
+        int Due(uint32_t slot) const { return nodes[slot].due; }
+
+        // Files the slot for due, replacing any earlier entry. now is the last turn already
+        // collected and due must be later.
+        void Schedule(uint32_t slot, int due, int now);
+        void Cancel(uint32_t slot);
+
+        // Unschedules every slot due at or before turn and appends it to out. Call once for
+        // each turn, in order; turns may restart from an earlier one, and slots then wait
+        // until due.
+        void Collect(int turn, std::vector<uint32_t>& out);
+
+        size_t Size() const { return scheduled; }
+
+    private:
+        static constexpr uint32_t kNil = UINT32_MAX;
+        static constexpr uint32_t kOverflow = 2 * kBuckets;
+
+        struct Node {
+            uint32_t prev = kNil;
+            uint32_t next = kNil;
+            uint32_t list = kNil;
+            int due = kNone;
+        };
+
+        void Link(uint32_t slot, int now);
+        void Unlink(uint32_t slot);
+        void Cascade(uint32_t list, int now);
+
+        std::vector<Node> nodes;
+        std::array<uint32_t, 2 * kBuckets + 1> heads;   // near buckets, mid buckets, overflow
+        size_t scheduled = 0;
+    };
+
+}
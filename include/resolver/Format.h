@@ -1,15 +1,29 @@
 #pragma once
+#include "Types.h"
+#include <charconv>
 #include <string>
-#include <sstream>
-#include <iomanip>
 
 namespace res {
 
+    // Fixed-point text of v with the given number of decimals, as printf("%.*f") writes it.
     inline std::string FmtFloat(float v, int decimals = 2) {
-        std::ostringstream oss;
-        oss.setf(std::ios::fixed);
-        oss << std::setprecision(decimals) << v;
-        return oss.str();
+        char buf[128];
+        const auto r = std::to_chars(buf, buf + sizeof(buf), (double)v, std::chars_format::fixed, decimals);
+        return r.ec == std::errc() ? std::string(buf, r.ptr) : std::string();
     }
 
-}
\ No newline at end of file
+    inline const char* DamageTypeName(DamageType t) {
+        switch(t) {
+            case DamageType::Physical: return "Physical";
+            case DamageType::Fire: return "Fire";
+            case DamageType::Ice: return "Ice";
+            case DamageType::Poison:return "Poison";
+            }
+        return "Unknown";
+    }
+
+    inline const char* HookName(Hook h) {
+        return h == Hook::OnBeforeDealDamage ? "OnBeforeDealDamage" : "OnBeforeTakeDamage";
+    }
+
+}
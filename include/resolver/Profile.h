@@ -0,0 +1,114 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+#ifndef RESOLVER_PROFILE
+#define RESOLVER_PROFILE 0
+#endif
+
+#if RESOLVER_PROFILE
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace res {
+
+    // Hot-path phases timed by ProfileProbe. Phases nest and are timed inclusively, so
+    // Resolve also covers the hook, mitigation and status phases it runs.
+    enum class ProfilePhase : uint8_t {
+        Resolve,            // one Resolver::Resolve request
+        TargetValidation,
+        EvalAmount,
+        DealHooks,          // OnBeforeDealDamage rules
+        TakeHooks,          // OnBeforeTakeDamage rules
+        Mitigation,         // armor and the hp write
+        StatusApply,        // World::AddStatus
+        StatusRemove,       // World::RemoveStatusesByTag
+        TraceFormat,        // ResolutionTrace::ToString
+        Tick,               // one World::TickTurnStart
+        TickCollect,        // gathering DoT rows and due expiries
+        TickRows,           // DoT damage and expiries of those rows
+        TickReschedule,     // filing rows that lost statuses at their next expiry
+        Count
+    };
+
+    inline constexpr size_t kProfilePhases = (size_t)ProfilePhase::Count;
+    // Bucket b counts durations whose width in clock ticks is b bits.
+    inline constexpr size_t kProfileBuckets = 65;
+    // Most recent spans kept per thread for the Chrome trace.
+    inline constexpr size_t kProfileSpans = 16384;
+
+    // Probes exist only in builds configured with -DRESOLVER_PROFILE=ON; otherwise
+    // ProfileProbe is an empty type and the collection functions report nothing.
+    inline constexpr bool kProfilingEnabled = RESOLVER_PROFILE != 0;
+
+    const char* ProfilePhaseName(ProfilePhase phase);
+
+    // One phase's timings merged over all threads.
+    struct PhaseProfile {
+        uint64_t count = 0;
+        double totalNs = 0;
+        double minNs = 0;
+        double maxNs = 0;
+        double nsPerTick = 1;
+        std::array<uint64_t, kProfileBuckets> buckets{};
+
+        double MeanNs() const { return count ? totalNs / (double)count : 0.0; }
+        // Upper bound of the histogram bucket holding quantile p, capped at maxNs.
+        double PercentileNs(double p) const;
+    };
+
+    // Timings of every thread that ran a probe, indexed by ProfilePhase. Threads record
+    // without locks, so this may be called at any time.
+    std::array<PhaseProfile, kProfilePhases> CollectProfile();
+
+    // Clears every thread's histograms and spans. Call while no probes are running.
+    void ResetProfile();
+
+    // Per-phase count, total, mean, min, max, percentiles and histogram.
+    void WriteProfileJson(std::ostream& out);
+    // Recent spans of every thread as complete ("X") events for chrome://tracing or Perfetto.
+    void WriteChromeTrace(std::ostream& out);
+
+#if RESOLVER_PROFILE
+    namespace detail {
+        // Time stamp counter where there is one, steady_clock nanoseconds elsewhere.
+        inline uint64_t ProfileClock() {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+        }
+
+        void RecordProbe(ProfilePhase phase, uint64_t start, uint64_t end);
+    }
+
+    // Times its own lifetime as one span of a phase on the calling thread.
+    class ProfileProbe {
+    public:
+        explicit ProfileProbe(ProfilePhase p) : phase(p), start(detail::ProfileClock()) {}
+        ~ProfileProbe() { detail::RecordProbe(phase, start, detail::ProfileClock()); }
+
+        ProfileProbe(const ProfileProbe&) = delete;
+        ProfileProbe& operator=(const ProfileProbe&) = delete;
+
+    private:
+        ProfilePhase phase;
+        uint64_t start;
+    };
+#else
+    class ProfileProbe {
+    public:
+        explicit ProfileProbe(ProfilePhase) {}
+
+        ProfileProbe(const ProfileProbe&) = delete;
+        ProfileProbe& operator=(const ProfileProbe&) = delete;
+    };
+#endif
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "Resolver.h"
+#include "World.h"
+#include <cstdint>
+#include <fstream>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace res {
+
+    // Binary replay log. After an 8-byte magic and a varint format version, the file is a
+    // sequence of entries: a kind byte followed by LEB128 varints (zigzag for signed values).
+    //
+    //   World       full entity state; the first entry, and again after each Resync
+    //   DbVersion   content version that following resolves ran against
+    //   Resolve     ability, caster, target count, targets
+    //   Tick        TickTurnStart
+    //   Checkpoint  ReplayStateHash of the world after the previous entry (8 raw bytes)
+    enum class ReplayEntry : uint8_t { World, DbVersion, Resolve, Tick, Checkpoint };
+
+    inline constexpr uint32_t kReplayFormatVersion = 1;
+
+    // Hash of everything resolution reads and writes: ids, stats, tags and statuses in order.
+    uint64_t ReplayStateHash(const World& world);
+
+    // Appends a world's resolves and ticks to a log. Attach with world.recorder = &recorder;
+    // Resolver and World then record each call before running it. Operations on a forked
+    // world are speculative and are not recorded. Mutations made outside Resolve and
+    // TickTurnStart (spawns, setup statuses) must be followed by Resync.
+    class ReplayRecorder {
+    public:
+        // checkpointEvery: write a checkpoint after every n-th tick (0 disables).
+        ReplayRecorder(const std::string& path, const World& initial, uint64_t dbVersion = 0, uint32_t checkpointEvery = 1);
+        ~ReplayRecorder();
+
+        ReplayRecorder(const ReplayRecorder&) = delete;
+        ReplayRecorder& operator=(const ReplayRecorder&) = delete;
+
+        void Resolve(const ResolveRequest& req, uint64_t dbVersion);
+        void Tick();
+        void AfterTick(const World& world);
+        void Checkpoint(const World& world);
+        void Resync(const World& world);
+        void Flush();
+
+        uint64_t Operations() const { return ops; }
+
+    private:
+        void Put(uint64_t v);
+        void PutSigned(int64_t v) { Put(((uint64_t)v << 1) ^ (uint64_t)(v >> 63)); }
+        void PutWorld(const World& world);
+        void MaybeFlush() { if (buffer.size() >= 64 * 1024) Flush(); }
+
+        std::ofstream file;
+        std::string buffer;
+        uint64_t lastDbVersion;
+        uint64_t ops = 0;
+        uint64_t ticks = 0;
+        uint32_t checkpointEvery;
+    };
+
+    struct ReplayOptions {
+        // Operations (resolves and ticks, numbered from 0) in [traceFrom, traceTo) are re-run
+        // with full tracing and their traces written to traceOut; everything else runs untraced.
+        uint64_t traceFrom = 0;
+        uint64_t traceTo = 0;
+        std::ostream* traceOut = nullptr;
+        bool stopOnMismatch = true;
+    };
+
+    struct ReplayReport {
+        uint64_t operations = 0;
+        uint64_t resolves = 0;
+        uint64_t ticks = 0;
+        uint64_t checkpoints = 0;
+        uint64_t mismatches = 0;
+        uint64_t firstMismatchOp = UINT64_MAX;  // operations executed before the first bad checkpoint
+        uint64_t failedResolves = 0;            // resolves that threw, as they did when recorded
+        std::vector<uint64_t> dbVersions;       // distinct content versions, in log order
+        World world;                            // state after the last entry
+    };
+
+    // Re-executes a log against db. Throws std::runtime_error on a malformed log.
+    ReplayReport Replay(const Db& db, const std::string& path, const ReplayOptions& opts = {});
+
+}
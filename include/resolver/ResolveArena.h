@@ -0,0 +1,46 @@
+#pragma once
+#include "Trace.h"
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+namespace res {
+
+    // Bump allocator for one request's trace, rendered text and scratch buffers. Reset
+    // drops everything at once; if the last cycle spilled past the buffer, the buffer is
+    // regrown to fit so a steady workload stops touching malloc. Not thread safe: keep
+    // one arena per worker thread.
+    class ResolveArena {
+    public:
+        explicit ResolveArena(size_t initialBytes = 64 * 1024);
+
+        ResolveArena(const ResolveArena&) = delete;
+        ResolveArena& operator=(const ResolveArena&) = delete;
+
+        std::pmr::memory_resource* Resource() { return &*bump; }
+        ResolutionTrace MakeTrace(TraceLevel level = TraceLevel::Full) { return ResolutionTrace(Resource(), level); }
+
+        // Everything allocated from the arena since the last reset must be dead.
+        void Reset();
+
+        size_t Capacity() const { return size; }
+
+    private:
+        // Upstream of the bump resource; records how much spilled past the buffer.
+        class Spill : public std::pmr::memory_resource {
+        public:
+            size_t bytes = 0;
+        private:
+            void* do_allocate(size_t n, size_t align) override;
+            void do_deallocate(void* p, size_t n, size_t align) override;
+            bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override { return this == &o; }
+        };
+
+        std::unique_ptr<std::byte[]> buffer;
+        size_t size;
+        Spill spill;
+        std::optional<std::pmr::monotonic_buffer_resource> bump;
+    };
+
+}
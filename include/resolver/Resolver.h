@@ -1,22 +1,48 @@
 #pragma once
 #include "Db.h"
+#include "DbRegistry.h"
 #include "World.h"
 #include "Trace.h"
+#include <memory_resource>
+#include <span>
 
 namespace res {
 
     struct ResolveRequest {
-        std::string abilityId;
+        AbilityHandle ability{};
         EntityId caster{};
         std::vector<EntityId> targets;
     };
 
+    class ThreadPool;
+
     struct Resolver {
-        const Db& db;
+        const Db* db = nullptr;                 // fixed content, or
+        const DbRegistry* registry = nullptr;   // hot-reloadable content, pinned once per call
+        ThreadPool* pool = nullptr;             // optional; ResolveBatch runs inline without one
+
+        explicit Resolver(const Db& d, ThreadPool* p = nullptr) : db(&d), pool(p) {}
+        explicit Resolver(const DbRegistry& r, ThreadPool* p = nullptr) : registry(&r), pool(p) {}
+
+        // The Db a call resolves against. Traces keep their snapshot pinned so they can be
+        // rendered after newer versions are published.
+        DbRegistry::Snapshot Pin() const;
 
-        explicit Resolver(const Db& d) : db(d) {}
+        // The returned trace allocates its events from mr when one is given (e.g. a ResolveArena).
+        ResolutionTrace Resolve(World& world, const ResolveRequest& req, TraceLevel level = TraceLevel::Full,
+                                std::pmr::memory_resource* mr = nullptr) const;
+        // Appends to an existing trace at its configured level; reusing one trace keeps its storage warm.
+        void Resolve(World& world, const ResolveRequest& req, ResolutionTrace& trace) const;
 
-        ResolutionTrace Resolve(World& world, const ResolveRequest& req) const;   
+        // Resolves many requests against one world. Requests whose caster/target sets are
+        // disjoint run concurrently on the pool; requests sharing an entity keep their
+        // submission order. Results (world state and traces[i]) match resolving the span
+        // sequentially. Every request is validated before any of them runs. Scheduling
+        // buffers come from scratch when given; traces use the default resource since
+        // requests fill them from several threads.
+        std::vector<ResolutionTrace> ResolveBatch(World& world, std::span<const ResolveRequest> reqs,
+                                                  TraceLevel level = TraceLevel::Full,
+                                                  std::pmr::memory_resource* scratch = nullptr) const;
     };
 
 }
\ No newline at end of file
@@ -0,0 +1,108 @@
+#pragma once
+#include "Resolver.h"
+#include "Wire.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace res {
+
+    struct ServerOptions {
+        std::string socketPath;
+        unsigned workers = std::thread::hardware_concurrency();
+        // Per connection: while this many requests await replies, or this many reply bytes
+        // await sending, the server stops reading from the connection.
+        uint32_t maxInFlight = 1024;
+        size_t maxOutbox = size_t{4} << 20;
+        // Spawns with a larger entity id get an error reply.
+        EntityId maxEntityId = (EntityId{1} << 24) - 1;
+    };
+
+    // Serves Wire messages for many encounter worlds over a Unix domain socket, all
+    // resolving against one shared Db. A single event-loop thread (the caller of Run) does
+    // all socket I/O and hands decoded requests to workers; encounter e is pinned to worker
+    // e % workers, which owns its World, so an encounter's requests run in the order they
+    // arrived while different encounters run in parallel. Clients may pipeline any number
+    // of requests; each gets one Reply carrying its tag, and replies for different
+    // encounters can arrive out of order. A client that pipelines past the per-connection
+    // caps in ServerOptions is simply not read from until it takes its replies, so the
+    // server buffers at most maxInFlight requests and about maxOutbox reply bytes for it.
+    // Spawn creates the encounter on first use and EndEncounter drops it; spawns with an id
+    // above maxEntityId or already in the encounter are refused.
+    class ResolverServer {
+    public:
+        // Binds and listens on options.socketPath, replacing a stale socket file left by
+        // a server that is no longer running. Throws std::system_error if the socket
+        // cannot be set up and std::runtime_error if a live server already owns the path.
+        ResolverServer(const Db& db, ServerOptions options);
+        ~ResolverServer();
+
+        ResolverServer(const ResolverServer&) = delete;
+        ResolverServer& operator=(const ResolverServer&) = delete;
+
+        // Serves until Stop is called.
+        void Run();
+        // Makes Run return; safe from any thread and from a signal handler.
+        void Stop();
+
+        // Requests answered so far.
+        uint64_t Served() const { return served.load(std::memory_order_relaxed); }
+
+    private:
+        struct Connection;
+        struct Worker;
+        struct Job {
+            std::shared_ptr<Connection> conn;
+            WireMessage msg;
+        };
+
+        void Shutdown();
+        void Wake();
+        void Accept();
+        void ReadFrom(Connection& conn, const std::shared_ptr<Connection>& owner, bool hangup);
+        bool DispatchFrames(Connection& conn, const std::shared_ptr<Connection>& owner);
+        void FlushTo(Connection& conn);
+        void Close(Connection& conn);
+        void WorkerLoop(Worker& worker);
+        void Execute(Worker& worker, const WireMessage& req, WireMessage& reply);
+
+        const Db& db;
+        Resolver resolver;
+        ServerOptions options;
+        int listenFd = -1;
+        int wakeFds[2] = {-1, -1};
+        std::atomic<bool> stopping{false};
+        std::atomic<uint64_t> served{0};
+        std::vector<std::shared_ptr<Connection>> connections;
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::vector<std::vector<Job>> dispatch;    // per worker, filled while reading
+    };
+
+    // Blocking client for ResolverServer. Send only queues the frame; Flush writes
+    // everything queued, and Receive flushes before waiting, so requests can be pipelined
+    // by sending several before receiving.
+    class ResolverClient {
+    public:
+        // Throws std::system_error if the server cannot be reached.
+        explicit ResolverClient(const std::string& socketPath);
+        ~ResolverClient();
+
+        ResolverClient(const ResolverClient&) = delete;
+        ResolverClient& operator=(const ResolverClient&) = delete;
+
+        void Send(const WireMessage& m) { EncodeFrame(m, out); }
+        void Flush();
+        // Next reply from the server; throws std::runtime_error if the server hangs up.
+        WireMessage Receive();
+
+    private:
+        int fd = -1;
+        std::string out;
+        std::string in;
+        size_t inPos = 0;
+    };
+
+}
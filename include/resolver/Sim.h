@@ -0,0 +1,107 @@
+#pragma once
+#include "Db.h"
+#include "World.h"
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace res {
+
+    class ThreadPool;
+
+    // How a combatant picks its next ability: in listed order, or at random by weight.
+    enum class RotationPolicy : uint8_t { Cycle, Random };
+    // How a combatant picks among candidate targets of a single or capped Group ability.
+    enum class TargetPolicy : uint8_t { Random, LowestHp };
+
+    struct SimCombatant {
+        Entity entity;                      // spawned with its starting statuses
+        uint32_t team = 0;
+        RotationPolicy rotation = RotationPolicy::Cycle;
+        TargetPolicy targeting = TargetPolicy::Random;
+        std::vector<AbilityHandle> abilities;
+        std::vector<uint32_t> weights;      // Random rotation only; empty means uniform
+    };
+
+    // One fight, repeated by Simulate. Each turn starts with TickTurnStart, then every living
+    // combatant acts in spec order. The fight ends when only one team has living combatants,
+    // or as a draw after maxTurns.
+    struct EncounterSpec {
+        std::vector<SimCombatant> combatants;
+        int maxTurns = 50;
+    };
+
+    // Reads the JSON encounter format:
+    //   {"maxTurns": 50, "combatants": [{"id": 1, "team": 0, "hp": 300, "armor": 5, "power": 20,
+    //     "statuses": [{"id": "shielded", "duration": 3, "stacks": 1}],
+    //     "rotation": "Cycle" | "Random", "targeting": "Random" | "LowestHp",
+    //     "abilities": ["firebolt", {"id": "strike", "weight": 3}]}]}
+    // Names are resolved against db. Throws std::runtime_error on unknown names or bad fields.
+    EncounterSpec ParseEncounterSpec(const Db& db, std::string_view json);
+    EncounterSpec LoadEncounterSpec(const Db& db, const std::string& path);
+
+    struct SimOptions {
+        uint64_t encounters = 100000;
+        uint64_t seed = 1;
+        ThreadPool* pool = nullptr;         // optional; runs inline without one
+    };
+
+    // Non-negative integer samples: exact count, sum, min and max, plus a histogram whose
+    // bucket width doubles whenever a sample would need more than kMaxBuckets buckets.
+    // Merging is exact and order independent, so reports do not depend on scheduling.
+    struct SimDistribution {
+        static constexpr size_t kMaxBuckets = 1024;
+
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t min = UINT64_MAX;
+        uint64_t max = 0;
+        uint64_t bucketWidth = 1;
+        std::vector<uint64_t> buckets;      // bucket b counts samples in [b, b + 1) * bucketWidth
+
+        void Add(uint64_t v);
+        void Merge(const SimDistribution& o);
+
+        double Mean() const { return count ? (double)sum / (double)count : 0.0; }
+        // Upper bound of the bucket holding quantile p, capped at max.
+        uint64_t Percentile(double p) const;
+
+    private:
+        void Widen(uint64_t width);
+    };
+
+    struct SimCombatantReport {
+        SimDistribution damageDealt;        // per encounter, by its abilities to anyone
+        SimDistribution damageTaken;        // per encounter, from abilities and DoTs
+        SimDistribution turnsToDeath;       // turn of death, over the encounters it died in
+        uint64_t aliveTurns = 0;            // turns it ended alive
+        std::vector<uint64_t> statusTurns;  // by StatusHandle: of those, turns ended with the status
+
+        double Uptime(StatusHandle s) const {
+            return aliveTurns && s < statusTurns.size() ? (double)statusTurns[s] / (double)aliveTurns : 0.0;
+        }
+    };
+
+    struct SimReport {
+        uint64_t encounters = 0;
+        uint64_t resolves = 0;
+        uint64_t ticks = 0;
+        std::vector<uint64_t> wins;         // by team
+        uint64_t draws = 0;
+        SimDistribution turns;              // encounter length
+        std::vector<SimCombatantReport> combatants;     // in spec order
+        double seconds = 0;
+    };
+
+    // Runs opts.encounters independent copies of the encounter. Encounter i draws from its own
+    // random stream seeded from (seed, i) and resolves with tracing off, so the report depends
+    // only on the spec, the content and the seed, never on the thread count.
+    // Throws std::runtime_error if the spec is unusable (no combatants, a combatant without
+    // abilities, duplicate ids, weights not matching abilities).
+    SimReport Simulate(const Db& db, const EncounterSpec& spec, const SimOptions& opts);
+
+    void WriteSimReportJson(const Db& db, const EncounterSpec& spec, const SimReport& report, std::ostream& out);
+
+}
@@ -0,0 +1,202 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace res {
+
+    // Vector with room for N elements inside the object, allocating only once it outgrows
+    // them. Most entities carry a handful of statuses and most defs a few tags and effects,
+    // which then sit next to the rest of their owner instead of in separate heap blocks.
+    // Member names follow std::vector so it drops into range-for, algorithms and JSON
+    // conversion; iterators are pointers and any growth invalidates them.
+    template <typename T, uint32_t N>
+    class SmallVector {
+        static_assert(N > 0, "SmallVector needs inline room for at least one element");
+
+    public:
+        using value_type = T;
+        using size_type = size_t;
+        using difference_type = ptrdiff_t;
+        using reference = T&;
+        using const_reference = const T&;
+        using pointer = T*;
+        using const_pointer = const T*;
+        using iterator = T*;
+        using const_iterator = const T*;
+
+        SmallVector() = default;
+        SmallVector(std::initializer_list<T> init) { assign(init.begin(), init.end()); }
+        template <std::input_iterator It>
+        SmallVector(It first, It last) { assign(first, last); }
+        SmallVector(const SmallVector& o) { assign(o.begin(), o.end()); }
+        SmallVector(SmallVector&& o) noexcept(std::is_nothrow_move_constructible_v<T>) { TakeFrom(o); }
+        ~SmallVector() { Release(); }
+
+        SmallVector& operator=(const SmallVector& o) {
+            if (this != &o) assign(o.begin(), o.end());
+            return *this;
+        }
+        SmallVector& operator=(SmallVector&& o) noexcept(std::is_nothrow_move_constructible_v<T>) {
+            if (this != &o) {
+                Release();
+                TakeFrom(o);
+            }
+            return *this;
+        }
+        SmallVector& operator=(std::initializer_list<T> init) {
+            assign(init.begin(), init.end());
+            return *this;
+        }
+
+        template <std::input_iterator It>
+        void assign(It first, It last) {
+            clear();
+            if constexpr (std::forward_iterator<It>) reserve((size_t)std::distance(first, last));
+            for (; first != last; ++first) emplace_back(*first);
+        }
+
+        T* data() { return ptr; }
+        const T* data() const { return ptr; }
+        size_t size() const { return count; }
+        size_t capacity() const { return cap; }
+        bool empty() const { return count == 0; }
+        // True while the elements still live in the inline storage.
+        bool IsInline() const { return ptr == Inline(); }
+
+        T* begin() { return ptr; }
+        T* end() { return ptr + count; }
+        const T* begin() const { return ptr; }
+        const T* end() const { return ptr + count; }
+
+        T& operator[](size_t i) { return ptr[i]; }
+        const T& operator[](size_t i) const { return ptr[i]; }
+        T& front() { return ptr[0]; }
+        const T& front() const { return ptr[0]; }
+        T& back() { return ptr[count - 1]; }
+        const T& back() const { return ptr[count - 1]; }
+
+        void reserve(size_t n) {
+            if (n > cap) Reallocate((uint32_t)n);
+        }
+
+        template <typename... Args>
+        T& emplace_back(Args&&... args) {
+            if (count == cap) return GrowAndEmplace(std::forward<Args>(args)...);
+            T* at = std::construct_at(ptr + count, std::forward<Args>(args)...);
+            ++count;
+            return *at;
+        }
+        void push_back(const T& v) { emplace_back(v); }
+        void push_back(T&& v) { emplace_back(std::move(v)); }
+
+        void pop_back() { std::destroy_at(ptr + --count); }
+
+        void clear() {
+            std::destroy(ptr, ptr + count);
+            count = 0;
+        }
+
+        void resize(size_t n) {
+            if (n < count) {
+                std::destroy(ptr + n, ptr + count);
+            } else {
+                reserve(n);
+                std::uninitialized_value_construct(ptr + count, ptr + n);
+            }
+            count = (uint32_t)n;
+        }
+
+        T* erase(const T* first, const T* last) {
+            T* const at = ptr + (first - ptr);
+            T* const tail = std::move(at + (last - first), end(), at);
+            std::destroy(tail, end());
+            count = (uint32_t)(tail - ptr);
+            return at;
+        }
+        T* erase(const T* pos) { return erase(pos, pos + 1); }
+
+        friend bool operator==(const SmallVector& a, const SmallVector& b) {
+            return std::equal(a.begin(), a.end(), b.begin(), b.end());
+        }
+
+    private:
+        T* Inline() { return std::launder(reinterpret_cast<T*>(inlineStorage)); }
+        const T* Inline() const { return std::launder(reinterpret_cast<const T*>(inlineStorage)); }
+
+        //Moves the elements into a heap block of newCap elements
+        void Reallocate(uint32_t newCap) {
+            T* heap = std::allocator<T>().allocate(newCap);
+            std::uninitialized_move(ptr, ptr + count, heap);
+            Adopt(heap, newCap);
+        }
+
+        //Builds the new element before moving the old ones, so args may refer into this vector
+        template <typename... Args>
+        T& GrowAndEmplace(Args&&... args) {
+            const uint32_t newCap = cap * 2;
+            T* heap = std::allocator<T>().allocate(newCap);
+            try {
+                std::construct_at(heap + count, std::forward<Args>(args)...);
+            } catch (...) {
+                std::allocator<T>().deallocate(heap, newCap);
+                throw;
+            }
+            std::uninitialized_move(ptr, ptr + count, heap);
+            Adopt(heap, newCap);
+            return ptr[count++];
+        }
+
+        //Replaces the current block with heap, which already holds the moved elements
+        void Adopt(T* heap, uint32_t newCap) {
+            std::destroy(ptr, ptr + count);
+            if (!IsInline()) std::allocator<T>().deallocate(ptr, cap);
+            ptr = heap;
+            cap = newCap;
+        }
+
+        void Release() {
+            clear();
+            if (!IsInline()) std::allocator<T>().deallocate(ptr, cap);
+            ptr = Inline();
+            cap = N;
+        }
+
+        //Takes o's elements, stealing its heap block when it has one; leaves o empty and inline
+        void TakeFrom(SmallVector& o) {
+            if (o.IsInline()) {
+                std::uninitialized_move(o.begin(), o.end(), Inline());
+                count = o.count;
+                o.clear();
+                return;
+            }
+            ptr = o.ptr;
+            count = o.count;
+            cap = o.cap;
+            o.ptr = o.Inline();
+            o.count = 0;
+            o.cap = N;
+        }
+
+        T* ptr = Inline();
+        uint32_t count = 0;
+        uint32_t cap = N;
+        alignas(T) unsigned char inlineStorage[N * sizeof(T)];
+    };
+
+    // Counterpart of std::erase_if, found by argument-dependent lookup.
+    template <typename T, uint32_t N, typename Pred>
+    size_t erase_if(SmallVector<T, N>& v, Pred pred) {
+        T* const from = std::remove_if(v.begin(), v.end(), pred);
+        const size_t removed = (size_t)(v.end() - from);
+        v.erase(from, v.end());
+        return removed;
+    }
+
+}
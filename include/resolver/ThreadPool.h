@@ -0,0 +1,40 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <deque>
+
+namespace res {
+
+    // Fixed-size worker pool. Work is submitted as index ranges through ParallelFor;
+    // the calling thread always participates, so a pool with zero workers degrades to
+    // running everything inline.
+    class ThreadPool {
+    public:
+        explicit ThreadPool(unsigned concurrency = std::thread::hardware_concurrency());
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Number of threads that execute work, including the caller of ParallelFor.
+        unsigned Concurrency() const { return (unsigned)threads.size() + 1; }
+
+        // Calls fn(i) for every i in [0, count) and returns once all calls have finished.
+        // If any call throws, the first exception is rethrown after the others complete.
+        void ParallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+    private:
+        void WorkerLoop();
+
+        std::vector<std::thread> threads;
+        std::deque<std::function<void()>> queue;
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool stopping = false;
+    };
+
+}
@@ -1,17 +1,82 @@
 #pragma once
+#include "Types.h"
+#include <memory>
+#include <memory_resource>
+#include <span>
 #include <string>
 #include <vector>
 
 namespace res {
 
+    struct Db;
+    class TraceSink;
+
+    enum class TraceLevel {
+        Off,        // record nothing
+        Summary,    // ability start, errors, effect outcomes and turn ticks
+        Full        // Summary plus every hook rule applied
+    };
+
+    // Typed, allocation-free record of one step of a resolution. Text is only
+    // produced when the trace is rendered with ResolutionTrace::ToString().
     struct TraceEvent {
-        std::string msg;
+        enum class Kind : uint8_t {
+            AbilityStart,
+            TargetError,
+            HookApplied,
+            Damage,
+            Heal,
+            StatusApplied,
+            StatusRemoved,
+            DotTick,
+            StatusExpired
+        } kind;
+
+        // The payload starts zeroed; callers fill in the member matching the kind.
+        explicit TraceEvent(Kind k) : kind(k), dot{} {}
+
+        union {
+            struct { AbilityHandle ability; EntityId caster; } abilityStart;
+            struct { TargetMode mode; } targetError;
+            struct { StatusHandle status; Hook hook; int stacks; float before; float after; } hook;
+            struct { EntityId target; DamageType damageType; int amount; int hpBefore; int hpAfter; } damage; // Damage and Heal
+            struct { StatusHandle status; int duration; } statusApplied;
+            struct { uint32_t tag; EntityId target; int removed; } statusRemoved; // tag indexes Db::tagNames
+            struct { EntityId entity; StatusHandle status; DamageType damageType; int amount; int stacks; } dot;
+            struct { EntityId entity; StatusHandle status; } expired;
+        };
     };
 
     struct ResolutionTrace {
-        std::vector<TraceEvent> events;
+        TraceLevel level = TraceLevel::Full;
+        const Db* db = nullptr;     // used to render handles back into ids
+        std::shared_ptr<const Db> pinned;   // keeps a hot-reloaded db alive; empty owner for a fixed Db
+        std::pmr::vector<TraceEvent> events;
+        // When set, events are rendered into the sink as they are added instead of being
+        // kept in events, so long audit traces stream out in constant memory.
+        TraceSink* sink = nullptr;
+
+        ResolutionTrace() = default;
+        // Events are allocated from mr, e.g. a ResolveArena, which must outlive the trace.
+        explicit ResolutionTrace(std::pmr::memory_resource* mr, TraceLevel l = TraceLevel::Full) : level(l), events(mr) {}
+
+        bool Enabled(TraceLevel l) const { return level >= l; }
+        void Add(const TraceEvent& e, TraceLevel l = TraceLevel::Summary) {
+            if (!Enabled(l)) return;
+            if (sink) Stream(e);
+            else events.push_back(e);
+        }
+        // Adds events recorded elsewhere at this trace's level, e.g. by a parallel tick chunk.
+        void Append(std::span<const TraceEvent> more);
+        void Clear() { events.clear(); }
 
-        void Add(std::string m) { events.push_back({std::move(m)}); }
         std::string ToString() const;
+        // Renders with every string, temporaries included, allocated from mr.
+        std::pmr::string ToString(std::pmr::memory_resource* mr) const;
+        // Renders the buffered events into out, one Write per event.
+        void WriteTo(TraceSink& out) const;
+
+    private:
+        void Stream(const TraceEvent& e);
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+namespace res {
+
+    // Destination for rendered trace text. A ResolutionTrace with a sink attached renders
+    // each event as it is recorded and hands over one event's lines per Write, instead
+    // of buffering the events; see ResolutionTrace::sink.
+    class TraceSink {
+    public:
+        virtual ~TraceSink() = default;
+        virtual void Write(std::string_view text) = 0;
+        virtual void Flush() {}
+    };
+
+    // Keeps everything written in memory.
+    class StringTraceSink : public TraceSink {
+    public:
+        void Write(std::string_view s) override { text.append(s.data(), s.size()); }
+
+        std::string text;
+    };
+
+    // Drops everything; the events are still rendered, so it measures formatting alone.
+    class NullTraceSink : public TraceSink {
+    public:
+        void Write(std::string_view) override {}
+    };
+
+    // Buffered writer to a file descriptor, flushed whenever kBufferBytes are pending, on
+    // Flush and on destruction.
+    class FileTraceSink : public TraceSink {
+    public:
+        static constexpr size_t kBufferBytes = 64 * 1024;
+
+        // Creates or truncates path. Throws std::system_error if it cannot be opened.
+        explicit FileTraceSink(const std::string& path);
+        // Writes to an already open descriptor, e.g. STDOUT_FILENO, without closing it.
+        explicit FileTraceSink(int fd);
+        ~FileTraceSink() override;
+
+        FileTraceSink(const FileTraceSink&) = delete;
+        FileTraceSink& operator=(const FileTraceSink&) = delete;
+
+        void Write(std::string_view text) override;
+        // Throws std::system_error if the descriptor rejects the data.
+        void Flush() override;
+
+    private:
+        int fd = -1;
+        bool owned = false;
+        std::string buffer;
+    };
+
+}
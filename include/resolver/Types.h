@@ -1,4 +1,6 @@
 #pragma once
+#include "SmallVector.h"
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -10,6 +12,21 @@ namespace res
 
     using EntityId = uint32_t;
 
+    // Dense indices into Db::abilities / Db::statuses, assigned by DbLoader.
+    using AbilityHandle = uint32_t;
+    using StatusHandle = uint32_t;
+
+    // Set of tags interned by the Db; bit i stands for Db::tagNames[i] for the first
+    // kMaskedTags tags. Any later tag sets kOverflowTag, so a mask test that hits that bit
+    // only says "some tag past the masked ones" and must be confirmed by name.
+    using TagMask = uint64_t;
+    inline constexpr size_t kMaskedTags = 63;
+    inline constexpr TagMask kOverflowTag = TagMask{1} << kMaskedTags;
+
+    inline constexpr TagMask TagBit(uint32_t index) {
+        return index < kMaskedTags ? TagMask{1} << index : kOverflowTag;
+    }
+
     enum class DamageType
     {
         Physical,
@@ -18,11 +35,18 @@ namespace res
         Poison
     };
 
+    // Entities carry no team or faction, so the resolver checks only target counts and the
+    // caster; "enemy" and "ally" name the caller's intent and the caller picks the targets.
     enum class TargetMode
     {
-        Self,
-        SingleEnemy,
-        SingleAlly
+        Self,           // exactly the caster
+        SingleEnemy,    // exactly one target, which may be anyone
+        SingleAlly,     // no checks
+        // Area modes: every listed target is hit, and caster-side amounts and hooks are
+        // evaluated once per effect rather than once per target.
+        AllEnemies,     // all non-caster targets: one or more, none of them the caster
+        AllAllies,      // one or more targets, the caster allowed
+        Group           // one to maxTargets targets
     };
 
     enum class Stat
@@ -41,6 +65,10 @@ namespace res
         std::optional<DamageType> incomingDamageType;
         std::optional<std::string> abilityHasTag;
         std::optional<std::string> targetHasStatusTag;
+
+        // Bits of the tags above (0 when absent), filled in by Db::AddStatus.
+        TagMask abilityTagMask = 0;
+        TagMask targetStatusTagMask = 0;
     };
 
     struct Modify {
@@ -63,6 +91,7 @@ namespace res
     struct AbilityTargeting
     {
         TargetMode mode = TargetMode::SingleEnemy;
+        int maxTargets = 0;     // Group only; 0 means no limit
     };
 
     struct AbilityEffectDef
@@ -73,25 +102,28 @@ namespace res
             Heal,
             ApplyStatus,
             RemoveStatusByTag
-        } kind;
+        } kind = Kind::Damage;
 
         DamageType damageType = DamageType::Physical;
         ScaledAmount amount{};
 
-        std::string statusId;
+        std::string statusId{};
+        StatusHandle status = 0;
         int duration = 0;
         int stacks = 0;
 
-        std::string tag;
+        std::string tag{};
+        TagMask tagMask = 0;
         int maxRemoved = 0;
     };
 
     struct AbilityDef
     {
         std::string id;
-        std::vector<std::string> tags;
+        SmallVector<std::string, 3> tags;
+        TagMask tagMask = 0;    // filled in by Db::AddAbility
         AbilityTargeting targeting{};
-        std::vector<AbilityEffectDef> effects;
+        SmallVector<AbilityEffectDef, 3> effects;
     };
 
     struct StatModDef
@@ -109,7 +141,8 @@ namespace res
     struct StatusDef
     {
         std::string id;
-        std::vector<std::string> tags;
+        SmallVector<std::string, 3> tags;
+        TagMask tagMask = 0;    // filled in by Db::AddStatus
         int maxStacks = 1;
         std::vector<StatModDef> statMods;
         std::unordered_map<Hook, std::vector<ModifierRule>> hooks;
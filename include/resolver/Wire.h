@@ -0,0 +1,48 @@
+#pragma once
+#include "Resolver.h"
+#include "World.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace res {
+
+    // Messages exchanged with resolver_server. Each frame is a 4-byte little-endian body
+    // length followed by the body: a kind byte, then LEB128 varints (zigzag for signed
+    // values) as laid out below.
+    //
+    //   Spawn         tag, encounter, entity (id, hp, armor, power, tags, statuses)
+    //   Resolve       tag, encounter, flags, ability, caster, target count, targets
+    //   Tick          tag, encounter, flags
+    //   EndEncounter  tag, encounter
+    //   Reply         tag, encounter, ok byte, state hash (8 raw bytes), text length, text
+    //
+    // The only flag is bit 0, asking for the rendered trace in the reply.
+    enum class WireKind : uint8_t { Spawn, Resolve, Tick, EndEncounter, Reply };
+
+    inline constexpr size_t kWireHeaderBytes = 4;
+    inline constexpr size_t kMaxWireFrameBytes = 1u << 20;
+
+    struct WireMessage {
+        WireKind kind = WireKind::Resolve;
+        uint64_t tag = 0;           // chosen by the client, echoed in the reply
+        uint32_t encounter = 0;
+        bool wantTrace = false;     // Resolve and Tick
+
+        Entity entity;              // Spawn
+        ResolveRequest request;     // Resolve
+
+        bool ok = true;             // Reply: false when the request threw
+        uint64_t stateHash = 0;     // Reply: World::StateHash of the encounter afterwards
+        std::string text;           // Reply: the error, or the trace when asked for
+    };
+
+    // Appends m as one frame.
+    void EncodeFrame(const WireMessage& m, std::string& out);
+
+    // Decodes the frame at the start of [data, data + size) into m and returns its length
+    // including the header, or 0 when the frame is not complete yet. Throws
+    // std::runtime_error on malformed or oversized frames.
+    size_t DecodeFrame(const char* data, size_t size, WireMessage& m);
+
+}
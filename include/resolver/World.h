@@ -2,43 +2,369 @@
 #include "Types.h"
 #include "Db.h"
 #include "Trace.h"
-#include <unordered_map>
-#include <unordered_set>
+#include "ExpiryWheel.h"
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <span>
 
 namespace res {
 
     struct StatusInstance {
-        std::string id;
+        StatusHandle status = 0;
         int stacks = 1;
         int remainingTurns = 1;
     };
 
+    // Value description of an entity, used to spawn entities and to take copies of them.
     struct Entity {
         EntityId id{};
         int hp = 100;
         int armor = 0;
         int power = 10;
 
-        std::unordered_set<std::string> tags;
-        std::vector<StatusInstance> statuses;
+        TagMask tags = 0;
+        SmallVector<StatusInstance, 4> statuses;    // copies of a typical entity never allocate
+    };
+
+    // Stable reference to a world slot. The generation changes when the slot is reused,
+    // so a handle to a despawned entity never aliases a newer one.
+    struct EntityHandle {
+        uint32_t index = 0;
+        uint32_t generation = 0;
+    };
+
+    struct World;
+
+    // Read-only view of one entity's statuses in the world status pool. The range is looked
+    // up when iteration starts, so a view stays valid across AddStatus/RemoveStatusesByTag.
+    struct StatusList {
+        const World* world = nullptr;
+        uint32_t row = 0;
+
+        struct iterator {
+            const World* world;
+            uint32_t index;
+
+            StatusInstance operator*() const;
+            iterator& operator++() { ++index; return *this; }
+            bool operator==(const iterator& o) const { return index == o.index; }
+        };
+
+        iterator begin() const;
+        iterator end() const;
+        size_t size() const;
+        bool empty() const { return size() == 0; }
+        StatusInstance operator[](size_t i) const { return *iterator{world, begin().index + (uint32_t)i}; }
+    };
+
+    struct ConstEntityRef {
+        EntityId id;
+        const int& hp;
+        const int& armor;
+        const int& power;
+        const TagMask& tags;
+        StatusList statuses;
+        uint32_t row;
+    };
+
+    // Live view of one entity's row. Field access reads the world columns directly;
+    // a ref is invalidated by Spawn and Despawn.
+    struct EntityRef {
+        EntityId id;
+        int& hp;
+        int& armor;
+        int& power;
+        TagMask& tags;
+        StatusList statuses;
+        uint32_t row;
+
+        operator ConstEntityRef() const { return {id, hp, armor, power, tags, statuses, row}; }
+    };
+
+    // Where a row's statuses live in the world status pool. Slots past count up to
+    // capacity are reserved for the row and hold inert entries.
+    struct StatusRange {
+        uint32_t begin = 0;
+        uint32_t count = 0;
+        uint32_t capacity = 0;
+    };
+
+    // One modifier rule from one of an entity's statuses, with the stack scaling already applied.
+    struct HookEntry {
+        const ModifierRule* rule = nullptr;
+        StatusHandle status = 0;
+        int stacks = 0;
+        float addFlat = 0.f;        // rule addFlat * stacks
+        float multiplier = 1.f;     // rule multiplier ^ stacks
+        bool conditional = false;   // rule has conditions beyond the incoming damage type
+    };
+
+    // Flattened hook rules of one entity, bucketed by (Hook, DamageType) in status order,
+    // plus the union of its statuses' tags. Rebuilt lazily after the entity's statuses change.
+    struct HookTable {
+        static constexpr size_t kDamageTypes = 4;
+        static constexpr size_t kBuckets = 2 * kDamageTypes;
+
+        std::vector<HookEntry> entries;
+        std::array<uint32_t, kBuckets + 1> offsets{};
+        TagMask statusTags = 0;
+        uint64_t builtFor = 0;          // DbStamp the table was built for, 0 when stale
+
+        static size_t Bucket(Hook h, DamageType t) { return (size_t)h * kDamageTypes + (size_t)t; }
+    };
+
+    // State of one row before the innermost open fork first touched it.
+    struct RowSave {
+        uint32_t row = 0;
+        int hp = 0;
+        int armor = 0;
+        int power = 0;
+        TagMask tags = 0;
+        uint32_t statusBegin = 0;   // into World::forkStatuses
+        uint32_t statusCount = 0;
+    };
+
+    class WorldFork;
+    class ThreadPool;
+    class ReplayRecorder;
+
+    // Additive hash that parallel batch resolves may update concurrently; wrapping addition
+    // makes the result independent of update order. Copies take the current value.
+    struct StateHashCell {
+        std::atomic<uint64_t> value{0};
+
+        StateHashCell() = default;
+        StateHashCell(const StateHashCell& o) : value(o.Load()) {}
+        StateHashCell& operator=(const StateHashCell& o) { value.store(o.Load(), std::memory_order_relaxed); return *this; }
+
+        uint64_t Load() const { return value.load(std::memory_order_relaxed); }
+        void Store(uint64_t h) { value.store(h, std::memory_order_relaxed); }
+        void Add(uint64_t key) { value.fetch_add(key, std::memory_order_relaxed); }
+        void Remove(uint64_t key) { value.fetch_sub(key, std::memory_order_relaxed); }
+    };
+
+    // EntityId -> slot table with open addressing and linear probing, kept at most half
+    // full. Its size follows the number of entities rather than their id values, so any
+    // 32-bit id is fine. Erase shifts later entries back instead of leaving tombstones.
+    struct IdSlotMap {
+        static constexpr uint32_t kAbsent = UINT32_MAX;
+
+        struct Entry {
+            EntityId id = 0;
+            uint32_t slot = kAbsent;    // kAbsent marks an empty entry
+        };
+        std::vector<Entry> entries;     // power-of-two size once anything is inserted
+        uint32_t count = 0;
+
+        uint32_t Find(EntityId id) const {
+            if (entries.empty()) return kAbsent;
+            const size_t mask = entries.size() - 1;
+            for (size_t i = Home(id, mask);; i = (i + 1) & mask) {
+                const Entry& e = entries[i];
+                if (e.slot == kAbsent || e.id == id) return e.slot;
+            }
+        }
+        // id must be absent. Grows before writing, so a throw leaves the map unchanged.
+        void Insert(EntityId id, uint32_t slot);
+        void Erase(EntityId id);
+
+        static size_t Home(EntityId id, size_t mask) { return (size_t)(((uint64_t)id * 0x9E3779B97F4A7C15ull) >> 32) & mask; }
+    };
+
+    // Clock and hash when a fork opened; DiscardFork restores them.
+    struct ForkStart {
+        uint64_t stateHash = 0;
+        uint64_t turnSteps = 0;
+        int turn = 0;
+    };
+
+    // Serialises expiry scheduling from parallel batch waves. Copies get a fresh mutex.
+    struct ScheduleLock {
+        std::mutex mutex;
+
+        ScheduleLock() = default;
+        ScheduleLock(const ScheduleLock&) {}
+        ScheduleLock& operator=(const ScheduleLock&) { return *this; }
+    };
+
+    // Replay recorder attached to a world. Copies of a world start unattached, so lookahead
+    // copies never write to the original's log.
+    struct RecorderLink {
+        ReplayRecorder* recorder = nullptr;
+
+        RecorderLink() = default;
+        RecorderLink(ReplayRecorder* r) : recorder(r) {}
+        RecorderLink(const RecorderLink&) {}
+        RecorderLink& operator=(const RecorderLink&) { return *this; }
+        RecorderLink& operator=(ReplayRecorder* r) { recorder = r; return *this; }
+
+        ReplayRecorder* operator->() const { return recorder; }
+        explicit operator bool() const { return recorder != nullptr; }
     };
 
     struct World {
-        std::unordered_map<EntityId, Entity> entities;
+        // Entity rows, stored column-wise and kept sorted by EntityId so iteration order
+        // is stable and streams through memory.
+        std::vector<EntityId> ids;
+        std::vector<int> hp;
+        std::vector<int> armor;
+        std::vector<int> power;
+        std::vector<TagMask> tags;
+        std::vector<StatusRange> statusRange;
+        std::vector<HookTable> hookTables;
+        std::vector<uint32_t> rowSlot;
+
+        // Status pool shared by all rows, stored column-wise. A status stores the turn it
+        // expires at, so remaining turns are statusExpiry - turn and a tick only has to advance
+        // the clock. Unused slots have stacks 0 and never expire.
+        std::vector<StatusHandle> statusDef;
+        std::vector<int> statusStacks;
+        std::vector<int> statusExpiry;
+        uint32_t statusGarbage = 0;     // pool slots no longer owned by any row
+        int turn = 0;                   // TickTurnStart calls so far
+
+        // Turn tick work lists, so a tick only visits rows with DoT or with something due.
+        // Each slot is filed in the wheel at its row's earliest expiry.
+        ExpiryWheel expiryWheel;
+        std::vector<uint32_t> dotSlots;         // slots with a status that carries a DoT
+        std::vector<uint32_t> slotDotIndex;     // per slot: position in dotSlots, UINT32_MAX if absent
+        std::vector<uint32_t> dotDirty;         // slots whose DoT membership is recomputed next tick
+        std::vector<uint8_t> slotDotDirty;
+        uint64_t dotBuiltFor = 0;               // DbStamp the DoT set was computed with
+        ScheduleLock scheduleLock;
+
+        // TickTurnStart scratch
+        std::vector<uint32_t> dueSlots;
+        std::vector<uint32_t> tickRows;
+        std::vector<uint8_t> tickMarks;     // per row, all zero between ticks
+        std::vector<ResolutionTrace> tickTraces;    // per-chunk traces of a parallel TickTurnStart
+
+        // Slot map: handles resolve through slotRow directly, ids through idSlot.
+        std::vector<uint32_t> slotRow;
+        std::vector<uint32_t> slotGeneration;
+        std::vector<uint32_t> freeSlots;
+        IdSlotMap idSlot;
+
+        // Fork journal: rows are saved the first time an open fork hands out mutable access
+        // to them, so discarding a fork restores only what it touched.
+        std::vector<RowSave> forkSaves;
+        std::vector<StatusInstance> forkStatuses;   // remainingTurns holds the raw expiry turn
+        std::vector<uint32_t> forkMarks;    // forkSaves size when each open fork started
+        std::vector<uint32_t> forkEpochs;   // epoch of each open fork, innermost last
+        std::vector<uint32_t> rowForkEpoch; // per row: epoch of the fork that last saved it
+        std::vector<ForkStart> forkStarts;  // hash and clock when each open fork started
+        uint32_t nextForkEpoch = 1;
+
+        // StateHash is stateHash - turn * turnSteps: statuses hash their expiry turn, and
+        // turnSteps sums their per-turn keys, so advancing the clock needs no per-status update.
+        StateHashCell stateHash;
+        StateHashCell turnSteps;
 
-        Entity& Get(EntityId id);
+        // Resolves and ticks on this world are appended here while no fork is open.
+        RecorderLink recorder;
 
-        const Entity& Get(EntityId id) const;
+        EntityHandle Spawn(Entity e);
+        void Despawn(EntityId id);
 
-        bool HasTag(const Entity& e, const std::string& tag) const;
-        bool HasStatusTag(const Db& db, const StatusInstance& si, const std::string &tag) const;
+        size_t Size() const { return ids.size(); }
+        bool Contains(EntityId id) const { return idSlot.Find(id) != IdSlotMap::kAbsent; }
+        bool IsAlive(EntityHandle h) const;
+        EntityHandle HandleOf(EntityId id) const;
 
-        int GetStat(const Entity& e, Stat s) const;
-        void AddStatus(const Db &db, Entity &target, const std::string &statusId, int duration, int stacks);
-        int RemoveStatusesByTag(const Db &db, Entity &target, const std::string &tag, int maxRemoved);
-        void TickTurnStart(const Db &db, ResolutionTrace &trace);
+        // Row index of a live entity; throws std::out_of_range for unknown ids or stale handles.
+        uint32_t RowOf(EntityId id) const;
+        uint32_t RowOf(EntityHandle h) const;
 
-        bool EntityHasAnyStatusWithTag(const Db& db, const Entity& e, const std::string& tag) const;
+        EntityRef Get(EntityId id) { return Row(RowOf(id)); }
+        ConstEntityRef Get(EntityId id) const { return Row(RowOf(id)); }
+        EntityRef Get(EntityHandle h) { return Row(RowOf(h)); }
+        ConstEntityRef Get(EntityHandle h) const { return Row(RowOf(h)); }
+
+        EntityRef Row(uint32_t row);
+        ConstEntityRef Row(uint32_t row) const;
+        StatusList Statuses(uint32_t row) const { return {this, row}; }
+
+        // Copies an entity back out into its value form.
+        Entity Snapshot(EntityId id) const;
+
+        // Tag tests are true when any bit of the mask is set. Tags past kMaskedTags share
+        // kOverflowTag, so these cannot tell them apart; entity tags are masks only.
+        bool HasTag(ConstEntityRef e, TagMask tag) const { return (e.tags & tag) != 0; }
+        bool HasStatusTag(const Db& db, const StatusInstance& si, TagMask tag) const;
+
+        int GetStat(ConstEntityRef e, Stat s) const;
+        // Writes a stat and updates StateHash; plain writes through EntityRef fields do not.
+        void SetStat(EntityRef e, Stat s, int value);
+        void AddStatus(const Db &db, EntityRef target, StatusHandle status, int duration, int stacks);
+        // Convenience for setup code; interns the id and forwards to the handle overload.
+        void AddStatus(const Db &db, EntityRef target, const std::string &statusId, int duration, int stacks);
+        int RemoveStatusesByTag(const Db &db, EntityRef target, TagMask tag, int maxRemoved);
+        // Exact for every tag, including those past kMaskedTags.
+        int RemoveStatusesByTag(const Db &db, EntityRef target, const std::string &tag, int maxRemoved);
+        // Applies DoT damage and counts down status durations. With a pool, large worlds are split
+        // into row chunks ticked concurrently; the trace is the same as a serial tick's, in
+        // ascending EntityId order. Ticks on a forked world always run on the calling thread.
+        void TickTurnStart(const Db &db, ResolutionTrace &trace, ThreadPool* pool = nullptr);
+
+        bool EntityHasAnyStatusWithTag(const Db& db, ConstEntityRef e, TagMask tag) const;
+        // Union of the tags of a row's statuses, cached with the row's hook table.
+        TagMask StatusTags(const Db& db, uint32_t row);
+
+        // Hook rules of a row that can apply to the given hook and damage type, in evaluation order.
+        std::span<const HookEntry> HookRules(const Db& db, uint32_t row, Hook hook, DamageType type);
+
+        // Starts a speculative branch on this world for lookahead. Nothing is copied up front;
+        // the first mutable access to a row (Get, Row, TickTurnStart) saves it, and the branch
+        // is discarded or merged in O(rows touched). Forks nest and must close innermost first.
+        // Spawn and Despawn throw while a fork is open.
+        WorldFork Fork();
+        void DiscardFork();
+        void MergeFork();
+        bool Forked() const { return !forkMarks.empty(); }
+
+        // Zobrist hash of every entity's hp, armor and power and every status's id, stacks and
+        // remaining turns. Spawn, Despawn, SetStat, AddStatus, RemoveStatusesByTag, TickTurnStart
+        // and fork discards keep it current in O(1) per changed value, so peers can compare it
+        // every tick. Call RehashState after writing EntityRef fields directly.
+        uint64_t StateHash() const { return stateHash.Load() - (uint64_t)turn * turnSteps.Load(); }
+        uint64_t RehashState();
+
+        // Makes room for extra statuses on a row so adding them cannot reallocate the pool.
+        void ReserveStatuses(uint32_t row, uint32_t extra);
+        // Repacks the status pool in row order, dropping slots orphaned by growth and despawns.
+        void CompactStatusPool();
+    };
+
+    // Open fork of a World; discards it on destruction unless merged or discarded first.
+    class WorldFork {
+    public:
+        explicit WorldFork(World& w) : world(&w) {}
+        ~WorldFork() { if (world) world->DiscardFork(); }
+
+        WorldFork(WorldFork&& o) noexcept : world(o.world) { o.world = nullptr; }
+        WorldFork(const WorldFork&) = delete;
+        WorldFork& operator=(const WorldFork&) = delete;
+        WorldFork& operator=(WorldFork&&) = delete;
+
+        World& operator*() const { return *world; }
+        World* operator->() const { return world; }
+
+        void Discard() { world->DiscardFork(); world = nullptr; }
+        void Merge() { world->MergeFork(); world = nullptr; }
+
+    private:
+        World* world;
     };
 
-}
\ No newline at end of file
+    inline StatusInstance StatusList::iterator::operator*() const {
+        return {world->statusDef[index], world->statusStacks[index], world->statusExpiry[index] - world->turn};
+    }
+    inline StatusList::iterator StatusList::begin() const { return {world, world->statusRange[row].begin}; }
+    inline StatusList::iterator StatusList::end() const {
+        const auto& r = world->statusRange[row];
+        return {world, r.begin + r.count};
+    }
+    inline size_t StatusList::size() const { return world->statusRange[row].count; }
+
+}
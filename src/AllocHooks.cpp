@@ -0,0 +1,48 @@
+#include "resolver/AllocStats.h"
+#include <cstdlib>
+#include <new>
+
+// Replacement global allocation functions that feed res::ThreadAllocations. Built as the
+// resolver_alloc_hooks object library so only binaries that ask for counting pay for it.
+
+[[maybe_unused]] static const bool kCountingEnabled = (res::detail::EnableAllocationCounting(), true);
+
+static void* Allocate(std::size_t n) {
+    res::detail::CountAllocation(n);
+    return std::malloc(n ? n : 1);
+}
+
+static void* AllocateAligned(std::size_t n, std::align_val_t al) {
+    res::detail::CountAllocation(n);
+    const std::size_t a = (std::size_t)al;
+    return std::aligned_alloc(a, (n + a - 1) / a * a);
+}
+
+void* operator new(std::size_t n) {
+    if (void* p = Allocate(n)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t n) { return operator new(n); }
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept { return Allocate(n); }
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept { return Allocate(n); }
+
+void* operator new(std::size_t n, std::align_val_t al) {
+    if (void* p = AllocateAligned(n, al)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t n, std::align_val_t al) { return operator new(n, al); }
+void* operator new(std::size_t n, std::align_val_t al, const std::nothrow_t&) noexcept { return AllocateAligned(n, al); }
+void* operator new[](std::size_t n, std::align_val_t al, const std::nothrow_t&) noexcept { return AllocateAligned(n, al); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
@@ -0,0 +1,21 @@
+#include "resolver/AllocStats.h"
+
+namespace res {
+
+    //Constant-initialized, so operator new can touch them on any thread at any time
+    static thread_local AllocStats threadAllocations;
+    static thread_local AllocProfile threadProfile;
+    static bool countingEnabled = false;
+
+    AllocStats ThreadAllocations() { return threadAllocations; }
+    bool AllocationCountingEnabled() { return countingEnabled; }
+    AllocProfile& ThreadAllocProfile() { return threadProfile; }
+
+    void detail::CountAllocation(uint64_t bytes) {
+        threadAllocations.allocations += 1;
+        threadAllocations.bytes += bytes;
+    }
+
+    void detail::EnableAllocationCounting() { countingEnabled = true; }
+
+}
@@ -1,19 +1,198 @@
 #include "resolver/Db.h"
+#include <atomic>
 #include <stdexcept>
 
 namespace res {
 
-    const AbilityDef& Db::GetAbility(const std::string& id) const {
-        auto it = abilities.find(id);
-        if (it == abilities.end()) throw std::runtime_error("Unknown Ability: " + id);
+    uint64_t DbStamp::Next() {
+        static std::atomic<uint64_t> next{1};
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static AbilityCode LowerTargeting(const AbilityDef& def) {
+        AbilityCode code;
+        code.mode = def.targeting.mode;
+        code.tagMask = def.tagMask;
+        switch (def.targeting.mode) {
+            case TargetMode::Self:
+                code.minTargets = code.maxTargets = 1;
+                code.casterOnly = true;
+                break;
+            case TargetMode::SingleEnemy:
+                code.minTargets = code.maxTargets = 1;
+                break;
+            case TargetMode::SingleAlly:
+                break;
+            //Not a faction check: the listed targets are hit as long as the caster is not among them
+            case TargetMode::AllEnemies:
+                code.minTargets = 1;
+                code.excludeCaster = true;
+                code.area = true;
+                break;
+            case TargetMode::AllAllies:
+                code.minTargets = 1;
+                code.area = true;
+                break;
+            case TargetMode::Group:
+                code.minTargets = 1;
+                if (def.targeting.maxTargets > 0) code.maxTargets = (uint32_t)def.targeting.maxTargets;
+                code.area = true;
+                break;
+        }
+        return code;
+    }
+
+    static EffectOp LowerEffect(const AbilityEffectDef& eff) {
+        EffectOp op;
+        switch (eff.kind) {
+            case AbilityEffectDef::Kind::Damage: op.code = EffectOpCode::Damage; break;
+            case AbilityEffectDef::Kind::Heal: op.code = EffectOpCode::Heal; break;
+            case AbilityEffectDef::Kind::ApplyStatus: op.code = EffectOpCode::ApplyStatus; break;
+            case AbilityEffectDef::Kind::RemoveStatusByTag: op.code = EffectOpCode::RemoveByTag; break;
+        }
+        op.damageType = eff.damageType;
+        op.scalesWith = eff.amount.scalesWith;
+        op.base = eff.amount.base;
+        op.scale = eff.amount.scale;
+        op.status = eff.status;
+        op.duration = eff.duration;
+        op.stacks = eff.stacks;
+        op.tagMask = eff.tagMask;
+        op.maxRemoved = eff.maxRemoved;
+        return op;
+    }
+
+    //Interns the def's tags and lowers it; ops are written over the ability's old block
+    //when they fit there and appended otherwise, and whatever the ability stops using is
+    //counted as garbage until CompactOps reclaims it
+    void Db::Lower(AbilityHandle h, AbilityDef& def) {
+        def.tagMask = InternTags(def.tags);
+        for (auto& eff : def.effects) {
+            if (eff.kind == AbilityEffectDef::Kind::RemoveStatusByTag) eff.tagMask = InternTag(eff.tag);
+        }
+
+        AbilityCode code = LowerTargeting(def);
+        code.opCount = (uint32_t)def.effects.size();
+        const bool replacing = h < abilityCode.size();
+        const uint32_t oldCount = replacing ? abilityCode[h].opCount : 0;
+        const bool fits = replacing && code.opCount <= oldCount;
+        code.firstOp = fits ? abilityCode[h].firstOp : (uint32_t)abilityOps.size();
+        if (!fits) abilityOps.resize(abilityOps.size() + code.opCount);
+        opGarbage += fits ? oldCount - code.opCount : oldCount;
+        for (uint32_t i = 0; i < code.opCount; ++i) {
+            EffectOp& op = abilityOps[code.firstOp + i];
+            op = LowerEffect(def.effects[i]);
+            if (op.code == EffectOpCode::RemoveByTag) op.tag = tagIndex.at(def.effects[i].tag);
+            code.applyStatusOps += def.effects[i].kind == AbilityEffectDef::Kind::ApplyStatus;
+        }
+
+        if (replacing) abilityCode[h] = code;
+        else abilityCode.push_back(code);
+        if (opGarbage > 64 && opGarbage * 2 > (uint32_t)abilityOps.size()) CompactOps();
+    }
+
+    void Db::CompactOps() {
+        std::vector<EffectOp> packed;
+        packed.reserve(abilityOps.size() - opGarbage);
+        for (AbilityCode& code : abilityCode) {
+            const uint32_t first = (uint32_t)packed.size();
+            packed.insert(packed.end(), abilityOps.begin() + code.firstOp, abilityOps.begin() + code.firstOp + code.opCount);
+            code.firstOp = first;
+        }
+        abilityOps = std::move(packed);
+        opGarbage = 0;
+    }
+
+    AbilityHandle Db::AddAbility(AbilityDef def) {
+        //Keep the first definition if an id is declared twice
+        auto it = abilityIndex.find(def.id);
+        if (it != abilityIndex.end()) return it->second;
+
+        stamp.Renew();
+        const AbilityHandle h = (AbilityHandle)abilities.size();
+        Lower(h, def);
+        abilityIndex.emplace(def.id, h);
+        abilities.push_back(std::move(def));
+        return h;
+    }
+
+    void Db::ReplaceAbility(AbilityHandle h, AbilityDef def) {
+        if (GetAbility(h).id != def.id)
+            throw std::runtime_error("ReplaceAbility cannot rename " + abilities[h].id + " to " + def.id);
+        stamp.Renew();
+        Lower(h, def);
+        abilities[h] = std::move(def);
+    }
+
+    StatusHandle Db::AddStatus(StatusDef def) {
+        auto it = statusIndex.find(def.id);
+        if (it != statusIndex.end()) return it->second;
+
+        def.tagMask = InternTags(def.tags);
+        for (auto& [hook, rules] : def.hooks) {
+            for (auto& rule : rules) {
+                if (rule.when.abilityHasTag) rule.when.abilityTagMask = InternTag(*rule.when.abilityHasTag);
+                if (rule.when.targetHasStatusTag) rule.when.targetStatusTagMask = InternTag(*rule.when.targetHasStatusTag);
+            }
+        }
+
+        stamp.Renew();
+        const StatusHandle h = (StatusHandle)statuses.size();
+        statusIndex.emplace(def.id, h);
+        dotPerStack.push_back(def.dot ? def.dot->perStackBase : 0);
+        hasDot.push_back(def.dot.has_value());
+        statuses.push_back(std::move(def));
+        return h;
+    }
+
+    TagMask Db::InternTag(const std::string& tag) {
+        auto it = tagIndex.find(tag);
+        if (it != tagIndex.end()) return TagBit(it->second);
+
+        const uint32_t index = (uint32_t)tagNames.size();
+        tagIndex.emplace(tag, index);
+        tagNames.push_back(tag);
+        return TagBit(index);
+    }
+
+    TagMask Db::InternTags(std::span<const std::string> tags) {
+        TagMask mask = 0;
+        for (const auto& t : tags) mask |= InternTag(t);
+        return mask;
+    }
+
+    TagMask Db::TagMaskOf(const std::string& tag) const {
+        auto it = tagIndex.find(tag);
+        return it == tagIndex.end() ? 0 : TagBit(it->second);
+    }
+
+    AbilityHandle Db::FindAbility(const std::string& id) const {
+        auto it = abilityIndex.find(id);
+        if (it == abilityIndex.end()) throw std::runtime_error("Unknown Ability: " + id);
         return it->second;
     }
 
-    const StatusDef& Db::GetStatus(const std::string& id) const {
-        auto it = statuses.find(id);
-        if (it == statuses.end())
+    StatusHandle Db::FindStatus(const std::string& id) const {
+        auto it = statusIndex.find(id);
+        if (it == statusIndex.end())
             throw std::runtime_error("Unknown Status: " + id);
         return it->second;
     }
 
-}
\ No newline at end of file
+    const AbilityDef& Db::GetAbility(AbilityHandle h) const {
+        if (h >= abilities.size()) throw std::runtime_error("Unknown Ability handle: " + std::to_string(h));
+        return abilities[h];
+    }
+
+    const AbilityCode& Db::GetAbilityCode(AbilityHandle h) const {
+        if (h >= abilityCode.size()) throw std::runtime_error("Unknown Ability handle: " + std::to_string(h));
+        return abilityCode[h];
+    }
+
+    const StatusDef& Db::GetStatus(StatusHandle h) const {
+        if (h >= statuses.size())
+            throw std::runtime_error("Unknown Status handle: " + std::to_string(h));
+        return statuses[h];
+    }
+
+}
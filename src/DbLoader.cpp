@@ -1,8 +1,10 @@
 #include "resolver/DbLoader.h"
+#include "resolver/ThreadPool.h"
 #include <nlohmann/json.hpp>
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
 #include <stdexcept>
-#include <iostream>
 
 using json = nlohmann::json;
 
@@ -40,6 +42,12 @@ namespace res {
             return TargetMode::SingleEnemy;
         if (s == "SingleAlly")
             return TargetMode::SingleAlly;
+        if (s == "AllEnemies")
+            return TargetMode::AllEnemies;
+        if (s == "AllAllies")
+            return TargetMode::AllAllies;
+        if (s == "Group")
+            return TargetMode::Group;
         throw std::runtime_error("Unknown TargetMode: " + s);
     }
 
@@ -65,157 +73,300 @@ namespace res {
         throw std::runtime_error("Unknown Hook: " + s);
     }
 
-    Db DbLoader::LoadFromFiles(const std::string& abilitiesPath, const std::string& statusesPath) {
-        Db db;
+    static StatusDef ParseStatus(const json& js) {
+        StatusDef s;
+        s.id = js.at("id").get<std::string>();
+        const auto tags = js.value("tags", std::vector<std::string>{});
+        s.tags.assign(tags.begin(), tags.end());
+        s.maxStacks = js.value("maxStacks", 1);
+
+        if(js.contains("statMods")) {
+            for(const auto& jm: js["statMods"]) {
+                if (!jm.contains("stat"))
+                    throw std::runtime_error("Status " + s.id + " statMods entry missing 'stat'");
+                if (!jm.contains("add"))
+                    throw std::runtime_error("Status " + s.id + " statMods entry missing 'add'");
+                s.statMods.push_back({
+                    ParseStats(jm.at("stat").get<std::string>()),
+                    jm.value("add", 0)
+                });
+            }
+        }
+
+        if(js.contains("dot")) {
+            DotDef d;
+            d.damageType = ParseDamageTypes(js["dot"].at("damageType").get<std::string>());
+            d.perStackBase = js["dot"].at("perStackBase").get<int>();
+            s.dot = d;
+        }
 
-        //Load statuses
+        if (js.contains("hooks"))
         {
-            std::ifstream f(statusesPath);
-            if(!f){
-                throw std::runtime_error("Failed to open file: " + statusesPath);
+            const auto &jhooks = js.at("hooks");
+            if (!jhooks.is_object())
+            {
+                throw std::runtime_error("Status " + s.id + " hooks must be an object");
             }
-            json root;
-            f >> root;
-            for(const auto& js: root.at("statuses")) {
-                StatusDef s;
-                s.id = js.at("id").get<std::string>();
-                s.tags = js.value("tags", std::vector<std::string>{});
-                s.maxStacks = js.value("maxStacks", 1);
-
-                if(js.contains("statMods")) {
-                    for(const auto& jm: js["statMods"]) {
-                        if (!jm.contains("stat"))
-                            throw std::runtime_error("Status " + s.id + " statMods entry missing 'stat'");
-                        if (!jm.contains("add"))
-                            throw std::runtime_error("Status " + s.id + " statMods entry missing 'add'");
-                        s.statMods.push_back({
-                            ParseStats(jm.at("stat").get<std::string>()),
-                            jm.value("add", 0)
-                        });
-                    }
-                }
 
-                if(js.contains("dot")) {
-                    DotDef d;
-                    d.damageType = ParseDamageTypes(js["dot"].at("damageType").get<std::string>());
-                    d.perStackBase = js["dot"].at("perStackBase").get<int>();
-                    s.dot = d;
+            for (auto it = jhooks.begin(); it != jhooks.end(); ++it)
+            {
+                const std::string hookName = it.key();
+                Hook hook = ParseHooks(hookName);
+
+                const auto &rulesArr = it.value();
+                if (!rulesArr.is_array())
+                {
+                    throw std::runtime_error("Status " + s.id + " hook " + hookName + " must be an array");
                 }
 
-                if (js.contains("hooks"))
+                auto &outRules = s.hooks[hook];
+                for (const auto &jr : rulesArr)
                 {
-                    const auto &jhooks = js.at("hooks");
-                    if (!jhooks.is_object())
-                    {
-                        throw std::runtime_error("Status " + s.id + " hooks must be an object");
-                    }
+                    ModifierRule r;
 
-                    for (auto it = jhooks.begin(); it != jhooks.end(); ++it)
+                    // when (optional)
+                    if (jr.contains("when"))
                     {
-                        const std::string hookName = it.key();
-                        Hook hook = ParseHooks(hookName);
-
-                        const auto &rulesArr = it.value();
-                        if (!rulesArr.is_array())
+                        const auto &jw = jr.at("when");
+                        if (jw.contains("incomingDamageType"))
                         {
-                            throw std::runtime_error("Status " + s.id + " hook " + hookName + " must be an array");
+                            r.when.incomingDamageType =
+                                ParseDamageTypes(jw.at("incomingDamageType").get<std::string>());
                         }
-
-                        auto &outRules = s.hooks[hook];
-                        for (const auto &jr : rulesArr)
+                        if (jw.contains("abilityHasTag"))
                         {
-                            ModifierRule r;
-
-                            // when (optional)
-                            if (jr.contains("when"))
-                            {
-                                const auto &jw = jr.at("when");
-                                if (jw.contains("incomingDamageType"))
-                                {
-                                    r.when.incomingDamageType =
-                                        ParseDamageTypes(jw.at("incomingDamageType").get<std::string>());
-                                }
-                                if (jw.contains("abilityHasTag"))
-                                {
-                                    r.when.abilityHasTag = jw.at("abilityHasTag").get<std::string>();
-                                }
-                                if (jw.contains("targetHasStatusTag"))
-                                {
-                                    r.when.targetHasStatusTag = jw.at("targetHasStatusTag").get<std::string>();
-                                }
-                            }
-
-                            // modify (required)
-                            if (!jr.contains("modify"))
-                            {
-                                throw std::runtime_error("Status " + s.id + " hook " + hookName + " rule missing modify");
-                            }
-                            const auto &jm = jr.at("modify");
-                            r.modify.addFlat = jm.value("addFlat", 0.0f);
-                            r.modify.multiplier = jm.value("multiplier", 1.0f);
-
-                            outRules.push_back(std::move(r));
+                            r.when.abilityHasTag = jw.at("abilityHasTag").get<std::string>();
+                        }
+                        if (jw.contains("targetHasStatusTag"))
+                        {
+                            r.when.targetHasStatusTag = jw.at("targetHasStatusTag").get<std::string>();
                         }
                     }
-                }
 
-                db.statuses.emplace(s.id, std::move(s));
+                    // modify (required)
+                    if (!jr.contains("modify"))
+                    {
+                        throw std::runtime_error("Status " + s.id + " hook " + hookName + " rule missing modify");
+                    }
+                    const auto &jm = jr.at("modify");
+                    r.modify.addFlat = jm.value("addFlat", 0.0f);
+                    r.modify.multiplier = jm.value("multiplier", 1.0f);
+
+                    outRules.push_back(std::move(r));
+                }
             }
         }
 
-        //Load abilities
-        {
-            std::ifstream f(abilitiesPath);
-            if(!f) {
-                throw std::runtime_error("Failed to open file at: " + abilitiesPath);
+        return s;
+    }
+
+    static AbilityDef ParseAbility(const json& ja) {
+        AbilityDef a;
+        a.id = ja.at("id").get<std::string>();
+        const auto tags = ja.value("tags", std::vector<std::string>{});
+        a.tags.assign(tags.begin(), tags.end());
+
+        a.targeting.mode = ParseTargetModes(ja.at("targeting").at("mode").get<std::string>());
+        a.targeting.maxTargets = ja.at("targeting").value("maxTargets", 0);
+        if (a.targeting.maxTargets < 0) throw std::runtime_error("Ability " + a.id + " has negative maxTargets");
+
+        for(const auto& je: ja.at("effects")) {
+            AbilityEffectDef e;
+
+            e.kind = ParseEffectKinds(je.at("type").get<std::string>());
+
+            if(e.kind == AbilityEffectDef::Kind::Damage || e.kind == AbilityEffectDef::Kind::Heal) {
+                e.damageType = ParseDamageTypes(je.value("damageType", "Physical"));
+                const auto& amnt = je.at("amount");
+                e.amount.base = amnt.at("base").get<float>();
+                e.amount.scalesWith = ParseStats(amnt.at("scalesWith").get<std::string>());
+                e.amount.scale = amnt.at("scale").get<float>();
             }
 
-            json root;
-            f >> root;
+            if(e.kind == AbilityEffectDef::Kind::ApplyStatus) {
+                e.statusId = je.at("statusId").get<std::string>();
+                e.duration = je.at("duration").get<int>();
+                e.stacks = je.value("stacks", 1);
+            }
 
-            for(const auto& ja: root.at("abilities")) {
-                AbilityDef a;
-                a.id = ja.at("id").get<std::string>();
-                a.tags = ja.value("tags", std::vector<std::string>{});
+            if(e.kind == AbilityEffectDef::Kind::RemoveStatusByTag) {
+                e.tag = je.at("tag").get<std::string>();
+                e.maxRemoved = je.at("maxRemoved").get<int>();
+            }
 
-                a.targeting.mode = ParseTargetModes(ja.at("targeting").at("mode").get<std::string>());
+            a.effects.push_back(std::move(e));
+        }
 
-                for(const auto& je: ja.at("effects")) {
-                    AbilityEffectDef e;
+        return a;
+    }
 
-                    e.kind = ParseEffectKinds(je.at("type").get<std::string>());
+    // Defs parsed from one content file, before ids are interned into a Db.
+    struct ContentShard {
+        std::string path;
+        std::vector<StatusDef> statuses;
+        std::vector<AbilityDef> abilities;
+        bool hasStatuses = false;
+        bool hasAbilities = false;
+    };
+
+    // Streams a content file, building a small DOM for one def at a time and converting it as
+    // soon as it closes, so peak memory is one def rather than the whole document.
+    class ContentSax : public json::json_sax_t {
+    public:
+        explicit ContentSax(ContentShard& s) : shard(s) {}
+
+        bool null() override { return Value(nullptr); }
+        bool boolean(bool v) override { return Value(v); }
+        bool number_integer(number_integer_t v) override { return Value(v); }
+        bool number_unsigned(number_unsigned_t v) override { return Value(v); }
+        bool number_float(number_float_t v, const string_t&) override { return Value(v); }
+        bool string(string_t& v) override { return Value(std::move(v)); }
+        bool binary(binary_t& v) override { return Value(json::binary(std::move(v))); }
+
+        bool start_object(std::size_t) override {
+            if (!stack.empty()) {
+                stack.push_back(Child(json::object()));
+            } else if (section != Section::None && depth == 2) {
+                def = json::object();
+                stack.push_back(&def);
+            }
+            ++depth;
+            return true;
+        }
 
-                    if(e.kind == AbilityEffectDef::Kind::Damage || e.kind == AbilityEffectDef::Kind::Heal) {
-                        e.damageType = ParseDamageTypes(je.value("damageType", "Physical"));
-                        const auto& amnt = je.at("amount");
-                        e.amount.base = amnt.at("base").get<float>();
-                        e.amount.scalesWith = ParseStats(amnt.at("scalesWith").get<std::string>());
-                        e.amount.scale = amnt.at("scale").get<float>();
-                    }
+        bool end_object() override {
+            --depth;
+            if (!stack.empty()) {
+                stack.pop_back();
+                if (stack.empty()) FinishDef();
+            }
+            return true;
+        }
 
-                    if(e.kind == AbilityEffectDef::Kind::ApplyStatus) {
-                        e.statusId = je.at("statusId").get<std::string>();
-                        e.duration = je.at("duration").get<int>();
-                        e.stacks = je.value("stacks", 1);
+        bool start_array(std::size_t) override {
+            if (!stack.empty()) {
+                stack.push_back(Child(json::array()));
+            } else if (depth == 1 && (rootKey == "statuses" || rootKey == "abilities")) {
+                section = rootKey == "statuses" ? Section::Statuses : Section::Abilities;
+                (section == Section::Statuses ? shard.hasStatuses : shard.hasAbilities) = true;
+            }
+            ++depth;
+            return true;
+        }
 
-                        if(!db.statuses.contains(e.statusId)) {
-                            throw std::runtime_error("Ability: " + a.id + " references unknown status: " + e.statusId + "!");
-                        }
-                    }
+        bool end_array() override {
+            --depth;
+            if (!stack.empty()) stack.pop_back();
+            else if (depth == 1) section = Section::None;
+            return true;
+        }
 
-                    if(e.kind == AbilityEffectDef::Kind::RemoveStatusByTag) {
-                        e.tag = je.at("tag").get<std::string>();
-                        e.maxRemoved = je.at("maxRemoved").get<int>();
-                    }
+        bool key(string_t& k) override {
+            if (!stack.empty()) key_ = std::move(k);
+            else if (depth == 1) rootKey = std::move(k);
+            return true;
+        }
 
-                    a.effects.push_back(std::move(e));
-                }
+        bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) override {
+            throw std::runtime_error("Failed to parse " + shard.path + ": " + ex.what());
+        }
+
+    private:
+        enum class Section { None, Statuses, Abilities };
 
-                db.abilities.emplace(a.id, std::move(a));
+        json* Child(json v) {
+            json& parent = *stack.back();
+            if (parent.is_object()) return &(parent[key_] = std::move(v));
+            parent.push_back(std::move(v));
+            return &parent.back();
+        }
+
+        bool Value(json v) {
+            if (!stack.empty()) {
+                Child(std::move(v));
+            } else if (section != Section::None && depth == 2) {
+                throw std::runtime_error("Content file " + shard.path + " has a non-object entry");
             }
+            return true;
         }
 
+        void FinishDef() {
+            if (section == Section::Statuses) shard.statuses.push_back(ParseStatus(def));
+            else shard.abilities.push_back(ParseAbility(def));
+        }
+
+        ContentShard& shard;
+        int depth = 0;
+        Section section = Section::None;
+        std::string rootKey;
+        std::string key_;
+        json def;
+        std::vector<json*> stack;
+    };
+
+    static ContentShard ParseShard(const std::string& path) {
+        ContentShard shard;
+        shard.path = path;
+
+        std::ifstream f(path, std::ios::binary);
+        if(!f) {
+            throw std::runtime_error("Failed to open file: " + path);
+        }
+        ContentSax sax(shard);
+        json::sax_parse(f, &sax);
+        return shard;
+    }
+
+    //Parses every file, concurrently when a pool is given; shards keep the order of paths
+    static std::vector<ContentShard> ParseShards(const std::vector<std::string>& paths, ThreadPool* pool) {
+        std::vector<ContentShard> shards(paths.size());
+        auto parse = [&](size_t i) { shards[i] = ParseShard(paths[i]); };
+        if (pool && paths.size() > 1) {
+            pool->ParallelFor(paths.size(), parse);
+        } else {
+            for (size_t i = 0; i < paths.size(); ++i) parse(i);
+        }
+        return shards;
+    }
+
+    //Adds all statuses, then all abilities, in shard order, and resolves cross references last
+    static Db Link(std::vector<ContentShard>& shards) {
+        Db db;
+        for (auto& shard : shards) {
+            for (auto& s : shard.statuses) db.AddStatus(std::move(s));
+        }
+
+        for (auto& shard : shards) {
+            for (auto& a : shard.abilities) {
+                for (auto& e : a.effects) {
+                    if (e.kind != AbilityEffectDef::Kind::ApplyStatus) continue;
+                    if (!db.HasStatus(e.statusId)) {
+                        throw std::runtime_error("Ability: " + a.id + " references unknown status: " + e.statusId + "!");
+                    }
+                    e.status = db.FindStatus(e.statusId);
+                }
+                db.AddAbility(std::move(a));
+            }
+        }
         return db;
     }
-}
 
+    Db DbLoader::LoadFromFiles(const std::string& abilitiesPath, const std::string& statusesPath, ThreadPool* pool) {
+        std::vector<ContentShard> shards = ParseShards({statusesPath, abilitiesPath}, pool);
+        if (!shards[0].hasStatuses) throw std::runtime_error("Status file " + statusesPath + " has no 'statuses' array");
+        if (!shards[1].hasAbilities) throw std::runtime_error("Ability file " + abilitiesPath + " has no 'abilities' array");
+        return Link(shards);
+    }
+
+    Db DbLoader::LoadFromDirectory(const std::string& dir, ThreadPool* pool) {
+        std::vector<std::string> paths;
+        for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".json") paths.push_back(entry.path().string());
+        }
+        //Directory order is unspecified; sort so handles do not depend on the filesystem
+        std::sort(paths.begin(), paths.end());
+
+        std::vector<ContentShard> shards = ParseShards(paths, pool);
+        return Link(shards);
+    }
+}
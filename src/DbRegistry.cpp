@@ -0,0 +1,66 @@
+#include "resolver/DbRegistry.h"
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace res {
+
+    //Handle h of the current Db must still name the same def in next
+    template <typename Def>
+    static void CheckHandlesKept(const char* kind, const std::vector<Def>& current, const std::vector<Def>& next) {
+        for (size_t h = 0; h < current.size(); ++h) {
+            if (h >= next.size())
+                throw std::runtime_error(std::string("Reload drops ") + kind + " '" + current[h].id + "'");
+            if (next[h].id != current[h].id)
+                throw std::runtime_error(std::string("Reload renumbers ") + kind + " '" + current[h].id + "': handle " +
+                                         std::to_string(h) + " is now '" + next[h].id + "'");
+        }
+    }
+
+    DbRegistry::DbRegistry(Db initial)
+        : current(new Node{std::make_shared<const Db>(std::move(initial)), 1}) {}
+
+    DbRegistry::~DbRegistry() {
+        delete current.load();
+    }
+
+    DbRegistry::Snapshot DbRegistry::Acquire() const {
+        //Register on the current epoch's counter; retry if a publisher flipped it in between
+        uint64_t e;
+        for (;;) {
+            e = epoch.load();
+            readers[e & 1].fetch_add(1);
+            if (epoch.load() == e) break;
+            readers[e & 1].fetch_sub(1);
+        }
+
+        const Node* n = current.load();
+        Snapshot s{n->db, n->version};
+        readers[e & 1].fetch_sub(1);
+        return s;
+    }
+
+    uint64_t DbRegistry::Publish(Db next) {
+        auto db = std::make_shared<const Db>(std::move(next));
+
+        std::lock_guard lock(publishMutex);
+        const Db& live = *current.load()->db;
+        CheckHandlesKept("Ability", live.abilities, db->abilities);
+        CheckHandlesKept("Status", live.statuses, db->statuses);
+        const uint64_t version = current.load()->version + 1;
+        Node* old = current.exchange(new Node{std::move(db), version});
+
+        //Readers that can still see old are registered on the pre-flip counter
+        const uint64_t e = epoch.fetch_add(1);
+        while (readers[e & 1].load() != 0) std::this_thread::yield();
+
+        //Dropping the node only releases its reference; pinned snapshots keep the Db alive
+        delete old;
+        return version;
+    }
+
+    uint64_t DbRegistry::Version() const {
+        return Acquire().version;
+    }
+
+}
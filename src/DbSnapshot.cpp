@@ -0,0 +1,330 @@
+#include "resolver/DbLoader.h"
+#include "resolver/DbSnapshot.h"
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace res {
+
+    using namespace snapshot;
+
+    static_assert(sizeof(Header) == 32 + 16 * (size_t)Section::Count, "Header must not contain padding");
+    static_assert(std::is_trivially_copyable_v<StatusRec> && std::is_trivially_copyable_v<AbilityRec> &&
+                  std::is_trivially_copyable_v<EffectRec> && std::is_trivially_copyable_v<RuleRec>,
+                  "Snapshot records are copied as raw bytes");
+    static_assert(alignof(Header) <= 8 && alignof(EffectRec) <= 8, "Sections are 8-byte aligned");
+
+    uint64_t snapshot::Checksum(const unsigned char* data, uint64_t size) {
+        constexpr uint64_t kPrime = 1099511628211ull;
+        uint64_t h = 14695981039346656037ull;
+        uint64_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, data + i, 8);
+            h = (h ^ word) * kPrime;
+        }
+        for (; i < size; ++i) h = (h ^ data[i]) * kPrime;
+        return h;
+    }
+
+    //Builds the snapshot tables in memory, interning strings as it goes
+    struct SnapshotWriter {
+        std::string strings;
+        std::unordered_map<std::string, StrRef> stringIndex;
+        std::vector<StrRef> tagNames, tagRefs;
+        std::vector<StatusRec> statuses;
+        std::vector<StatModRec> statMods;
+        std::vector<RuleRec> rules;
+        std::vector<AbilityRec> abilities;
+        std::vector<EffectRec> effects;
+
+        StrRef Str(const std::string& s) {
+            auto it = stringIndex.find(s);
+            if (it != stringIndex.end()) return it->second;
+            const StrRef ref{(uint32_t)strings.size(), (uint32_t)s.size()};
+            strings += s;
+            stringIndex.emplace(s, ref);
+            return ref;
+        }
+
+        Range Tags(std::span<const std::string> tags) {
+            const Range r{(uint32_t)tagRefs.size(), (uint32_t)tags.size()};
+            for (const auto& t : tags) tagRefs.push_back(Str(t));
+            return r;
+        }
+    };
+
+    template <typename T>
+    static void AppendSection(std::string& out, Header& header, Section s, const T* data, size_t count) {
+        out.resize((out.size() + 7) & ~size_t{7}, '\0');
+        header.sections[(uint32_t)s] = {(uint64_t)out.size(), (uint64_t)count};
+        out.append(reinterpret_cast<const char*>(data), count * sizeof(T));
+    }
+
+    void DbLoader::WriteSnapshot(const Db& db, const std::string& path) {
+        SnapshotWriter w;
+
+        for (const auto& t : db.tagNames) w.tagNames.push_back(w.Str(t));
+
+        for (const auto& s : db.statuses) {
+            StatusRec rec{};
+            rec.id = w.Str(s.id);
+            rec.tags = w.Tags(s.tags);
+            rec.maxStacks = s.maxStacks;
+
+            rec.statMods.begin = (uint32_t)w.statMods.size();
+            for (const auto& m : s.statMods) w.statMods.push_back({(uint32_t)m.stat, m.add});
+            rec.statMods.count = (uint32_t)w.statMods.size() - rec.statMods.begin;
+
+            //Hooks are an unordered map; write them in Hook order so packing is deterministic
+            rec.rules.begin = (uint32_t)w.rules.size();
+            for (Hook hook : {Hook::OnBeforeDealDamage, Hook::OnBeforeTakeDamage}) {
+                auto it = s.hooks.find(hook);
+                if (it == s.hooks.end()) continue;
+                for (const auto& r : it->second) {
+                    RuleRec rr{};
+                    rr.hook = (uint32_t)hook;
+                    if (r.when.incomingDamageType) {
+                        rr.flags |= kRuleHasDamageType;
+                        rr.damageType = (uint32_t)*r.when.incomingDamageType;
+                    }
+                    if (r.when.abilityHasTag) {
+                        rr.flags |= kRuleHasAbilityTag;
+                        rr.abilityTag = w.Str(*r.when.abilityHasTag);
+                    }
+                    if (r.when.targetHasStatusTag) {
+                        rr.flags |= kRuleHasTargetStatusTag;
+                        rr.targetStatusTag = w.Str(*r.when.targetHasStatusTag);
+                    }
+                    rr.addFlat = r.modify.addFlat;
+                    rr.multiplier = r.modify.multiplier;
+                    w.rules.push_back(rr);
+                }
+            }
+            rec.rules.count = (uint32_t)w.rules.size() - rec.rules.begin;
+
+            if (s.dot) {
+                rec.hasDot = 1;
+                rec.dotDamageType = (uint32_t)s.dot->damageType;
+                rec.dotPerStackBase = s.dot->perStackBase;
+            }
+            w.statuses.push_back(rec);
+        }
+
+        for (const auto& a : db.abilities) {
+            AbilityRec rec{};
+            rec.id = w.Str(a.id);
+            rec.tags = w.Tags(a.tags);
+            rec.targetMode = (uint32_t)a.targeting.mode;
+            rec.maxTargets = a.targeting.maxTargets;
+            rec.effects.begin = (uint32_t)w.effects.size();
+            for (const auto& e : a.effects) {
+                EffectRec er{};
+                er.kind = (uint32_t)e.kind;
+                er.damageType = (uint32_t)e.damageType;
+                er.amountBase = e.amount.base;
+                er.amountScalesWith = (uint32_t)e.amount.scalesWith;
+                er.amountScale = e.amount.scale;
+                er.statusId = w.Str(e.statusId);
+                er.status = e.status;
+                er.duration = e.duration;
+                er.stacks = e.stacks;
+                er.tag = w.Str(e.tag);
+                er.maxRemoved = e.maxRemoved;
+                w.effects.push_back(er);
+            }
+            rec.effects.count = (uint32_t)a.effects.size();
+            w.abilities.push_back(rec);
+        }
+
+        Header header{};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.headerSize = sizeof(Header);
+
+        std::string out(sizeof(Header), '\0');
+        AppendSection(out, header, Section::Strings, w.strings.data(), w.strings.size());
+        AppendSection(out, header, Section::TagNames, w.tagNames.data(), w.tagNames.size());
+        AppendSection(out, header, Section::TagRefs, w.tagRefs.data(), w.tagRefs.size());
+        AppendSection(out, header, Section::Statuses, w.statuses.data(), w.statuses.size());
+        AppendSection(out, header, Section::StatMods, w.statMods.data(), w.statMods.size());
+        AppendSection(out, header, Section::Rules, w.rules.data(), w.rules.size());
+        AppendSection(out, header, Section::Abilities, w.abilities.data(), w.abilities.size());
+        AppendSection(out, header, Section::Effects, w.effects.data(), w.effects.size());
+
+        header.fileSize = out.size();
+        header.checksum = Checksum(reinterpret_cast<const unsigned char*>(out.data()) + sizeof(Header), out.size() - sizeof(Header));
+        std::memcpy(out.data(), &header, sizeof(Header));
+
+        std::ofstream f(path, std::ios::binary | std::ios::trunc);
+        if (!f) throw std::runtime_error("Failed to open file for writing: " + path);
+        f.write(out.data(), (std::streamsize)out.size());
+        if (!f) throw std::runtime_error("Failed to write snapshot: " + path);
+    }
+
+    //Read-only mapping of a whole file, unmapped on destruction
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string& path) {
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) throw std::runtime_error("Failed to open file: " + path);
+            struct stat st{};
+            if (::fstat(fd, &st) != 0) {
+                ::close(fd);
+                throw std::runtime_error("Failed to stat file: " + path);
+            }
+            size = (size_t)st.st_size;
+            if (size > 0) {
+                void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p == MAP_FAILED) {
+                    ::close(fd);
+                    throw std::runtime_error("Failed to map file: " + path);
+                }
+                data = static_cast<const unsigned char*>(p);
+            }
+            ::close(fd);
+        }
+        ~MappedFile() {
+            if (data) ::munmap(const_cast<unsigned char*>(data), size);
+        }
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+    };
+
+    //Validated pointers into a mapped snapshot
+    struct SnapshotView {
+        const std::string& path;
+        const unsigned char* base;
+        const Header* header;
+        std::string_view strings;
+
+        [[noreturn]] void Fail(const std::string& why) const {
+            throw std::runtime_error("Invalid snapshot " + path + ": " + why);
+        }
+
+        template <typename T>
+        std::span<const T> Table(Section s) const {
+            const SectionEntry& e = header->sections[(uint32_t)s];
+            if (e.offset % alignof(T) != 0 || e.offset > header->fileSize ||
+                e.count > (header->fileSize - e.offset) / sizeof(T)) {
+                Fail("section " + std::to_string((uint32_t)s) + " out of bounds");
+            }
+            return {reinterpret_cast<const T*>(base + e.offset), (size_t)e.count};
+        }
+
+        template <typename T>
+        std::span<const T> Slice(std::span<const T> table, Range r) const {
+            if (r.begin > table.size() || r.count > table.size() - r.begin) Fail("record range out of bounds");
+            return table.subspan(r.begin, r.count);
+        }
+
+        std::string Str(StrRef r) const {
+            if (r.offset > strings.size() || r.length > strings.size() - r.offset) Fail("string out of bounds");
+            return std::string(strings.substr(r.offset, r.length));
+        }
+
+        template <typename E>
+        E Enum(uint32_t v, E last) const {
+            if (v > (uint32_t)last) Fail("enum value out of range: " + std::to_string(v));
+            return (E)v;
+        }
+    };
+
+    Db DbLoader::LoadFromSnapshot(const std::string& path) {
+        MappedFile file(path);
+        if (file.size < sizeof(Header)) throw std::runtime_error("Invalid snapshot " + path + ": file too small");
+
+        const auto* header = reinterpret_cast<const Header*>(file.data);
+        SnapshotView v{path, file.data, header, {}};
+        if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0) v.Fail("bad magic");
+        if (header->version != kVersion) {
+            v.Fail("format version " + std::to_string(header->version) + ", expected " + std::to_string(kVersion));
+        }
+        if (header->headerSize != sizeof(Header) || header->fileSize != file.size) v.Fail("size mismatch");
+        if (Checksum(file.data + sizeof(Header), file.size - sizeof(Header)) != header->checksum) v.Fail("checksum mismatch");
+
+        const auto strings = v.Table<char>(Section::Strings);
+        v.strings = {strings.data(), strings.size()};
+        const auto tagNames = v.Table<StrRef>(Section::TagNames);
+        const auto tagRefs = v.Table<StrRef>(Section::TagRefs);
+        const auto statuses = v.Table<StatusRec>(Section::Statuses);
+        const auto statMods = v.Table<StatModRec>(Section::StatMods);
+        const auto rules = v.Table<RuleRec>(Section::Rules);
+        const auto abilities = v.Table<AbilityRec>(Section::Abilities);
+        const auto effects = v.Table<EffectRec>(Section::Effects);
+
+        auto readTags = [&](Range r) {
+            SmallVector<std::string, 3> out;
+            for (const auto& t : v.Slice(tagRefs, r)) out.push_back(v.Str(t));
+            return out;
+        };
+
+        Db db;
+        db.abilities.reserve(abilities.size());
+        db.statuses.reserve(statuses.size());
+
+        //Intern tags first so every bit matches the packed Db
+        for (const auto& t : tagNames) db.InternTag(v.Str(t));
+
+        for (const auto& rec : statuses) {
+            StatusDef s;
+            s.id = v.Str(rec.id);
+            s.tags = readTags(rec.tags);
+            s.maxStacks = rec.maxStacks;
+            for (const auto& m : v.Slice(statMods, rec.statMods)) {
+                s.statMods.push_back({v.Enum(m.stat, Stat::Power), m.add});
+            }
+            for (const auto& rr : v.Slice(rules, rec.rules)) {
+                ModifierRule r;
+                if (rr.flags & kRuleHasDamageType) r.when.incomingDamageType = v.Enum(rr.damageType, DamageType::Poison);
+                if (rr.flags & kRuleHasAbilityTag) r.when.abilityHasTag = v.Str(rr.abilityTag);
+                if (rr.flags & kRuleHasTargetStatusTag) r.when.targetHasStatusTag = v.Str(rr.targetStatusTag);
+                r.modify = {rr.addFlat, rr.multiplier};
+                s.hooks[v.Enum(rr.hook, Hook::OnBeforeTakeDamage)].push_back(std::move(r));
+            }
+            if (rec.hasDot) s.dot = DotDef{v.Enum(rec.dotDamageType, DamageType::Poison), rec.dotPerStackBase};
+            db.AddStatus(std::move(s));
+        }
+
+        for (const auto& rec : abilities) {
+            AbilityDef a;
+            a.id = v.Str(rec.id);
+            a.tags = readTags(rec.tags);
+            a.targeting.mode = v.Enum(rec.targetMode, TargetMode::Group);
+            if (rec.maxTargets < 0) v.Fail("negative maxTargets");
+            a.targeting.maxTargets = rec.maxTargets;
+            for (const auto& er : v.Slice(effects, rec.effects)) {
+                AbilityEffectDef e{v.Enum(er.kind, AbilityEffectDef::Kind::RemoveStatusByTag)};
+                e.damageType = v.Enum(er.damageType, DamageType::Poison);
+                e.amount = {er.amountBase, v.Enum(er.amountScalesWith, Stat::Power), er.amountScale};
+                e.statusId = v.Str(er.statusId);
+                e.status = er.status;
+                e.duration = er.duration;
+                e.stacks = er.stacks;
+                e.tag = v.Str(er.tag);
+                e.maxRemoved = er.maxRemoved;
+                if (e.kind == AbilityEffectDef::Kind::ApplyStatus && e.status >= db.statuses.size()) {
+                    v.Fail("ability " + a.id + " references unknown status handle " + std::to_string(e.status));
+                }
+                a.effects.push_back(std::move(e));
+            }
+            db.AddAbility(std::move(a));
+        }
+
+        if (db.statuses.size() != statuses.size() || db.abilities.size() != abilities.size()) v.Fail("duplicate ids");
+        return db;
+    }
+
+}
@@ -0,0 +1,74 @@
+#include "resolver/ExpiryWheel.h"
+
+namespace res {
+
+    static constexpr int kNearSpan = ExpiryWheel::kBuckets;
+    static constexpr int kMidSpan = ExpiryWheel::kBuckets * ExpiryWheel::kBuckets;
+
+    void ExpiryWheel::Resize(size_t n) {
+        if (n > nodes.size()) nodes.resize(n);
+    }
+
+    void ExpiryWheel::Link(uint32_t slot, int now) {
+        Node& node = nodes[slot];
+        //A due exactly one span ahead lands in the bucket just collected, which comes up next at due
+        const int64_t delta = (int64_t)node.due - now;
+        if (delta <= kNearSpan) node.list = (uint32_t)node.due % kBuckets;
+        else if (delta <= kMidSpan) node.list = kBuckets + ((uint32_t)node.due / kBuckets) % kBuckets;
+        else node.list = kOverflow;
+
+        node.prev = kNil;
+        node.next = heads[node.list];
+        if (node.next != kNil) nodes[node.next].prev = slot;
+        heads[node.list] = slot;
+    }
+
+    void ExpiryWheel::Unlink(uint32_t slot) {
+        Node& node = nodes[slot];
+        if (node.prev != kNil) nodes[node.prev].next = node.next;
+        else heads[node.list] = node.next;
+        if (node.next != kNil) nodes[node.next].prev = node.prev;
+        node.prev = node.next = node.list = kNil;
+    }
+
+    void ExpiryWheel::Schedule(uint32_t slot, int due, int now) {
+        Cancel(slot);
+        nodes[slot].due = due;
+        Link(slot, now);
+        ++scheduled;
+    }
+
+    void ExpiryWheel::Cancel(uint32_t slot) {
+        if (nodes[slot].due == kNone) return;
+        Unlink(slot);
+        nodes[slot].due = kNone;
+        --scheduled;
+    }
+
+    void ExpiryWheel::Cascade(uint32_t list, int now) {
+        uint32_t slot = heads[list];
+        heads[list] = kNil;
+        while (slot != kNil) {
+            const uint32_t next = nodes[slot].next;
+            Link(slot, now);
+            slot = next;
+        }
+    }
+
+    void ExpiryWheel::Collect(int turn, std::vector<uint32_t>& out) {
+        //Cascade first, so slots due this very turn reach the near bucket before it is read
+        if ((uint32_t)turn % kMidSpan == 0) Cascade(kOverflow, turn - 1);
+        if ((uint32_t)turn % kNearSpan == 0) Cascade(kBuckets + ((uint32_t)turn / kBuckets) % kBuckets, turn - 1);
+
+        uint32_t slot = heads[(uint32_t)turn % kBuckets];
+        while (slot != kNil) {
+            const uint32_t next = nodes[slot].next;
+            if (nodes[slot].due <= turn) {
+                Cancel(slot);
+                out.push_back(slot);
+            }
+            slot = next;
+        }
+    }
+
+}
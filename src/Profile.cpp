@@ -0,0 +1,253 @@
+#include "resolver/Profile.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+namespace res {
+
+    using json = nlohmann::json;
+
+    const char* ProfilePhaseName(ProfilePhase phase) {
+        switch (phase) {
+            case ProfilePhase::Resolve: return "resolve";
+            case ProfilePhase::TargetValidation: return "target_validation";
+            case ProfilePhase::EvalAmount: return "eval_amount";
+            case ProfilePhase::DealHooks: return "deal_hooks";
+            case ProfilePhase::TakeHooks: return "take_hooks";
+            case ProfilePhase::Mitigation: return "mitigation";
+            case ProfilePhase::StatusApply: return "status_apply";
+            case ProfilePhase::StatusRemove: return "status_remove";
+            case ProfilePhase::TraceFormat: return "trace_format";
+            case ProfilePhase::Tick: return "tick";
+            case ProfilePhase::TickCollect: return "tick_collect";
+            case ProfilePhase::TickRows: return "tick_rows";
+            case ProfilePhase::TickReschedule: return "tick_reschedule";
+            case ProfilePhase::Count: break;
+        }
+        return "unknown";
+    }
+
+    double PhaseProfile::PercentileNs(double p) const {
+        if (count == 0) return 0.0;
+        const uint64_t rank = std::max<uint64_t>(1, (uint64_t)(p * (double)count + 0.5));
+        uint64_t seen = 0;
+        for (size_t b = 0; b < kProfileBuckets; ++b) {
+            seen += buckets[b];
+            if (seen < rank) continue;
+            const double upperTicks = b == 0 ? 0.0 : b >= 64 ? (double)UINT64_MAX : (double)((uint64_t(1) << b) - 1);
+            return std::min(upperTicks * nsPerTick, maxNs);
+        }
+        return maxNs;
+    }
+
+    //Every counter has a single writer, its thread, which updates it with plain loads and
+    //stores; readers only ever see whole values, so nothing takes a lock or a locked RMW
+    struct PhaseCounters {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> ticks{0};
+        std::atomic<uint64_t> minTicks{UINT64_MAX};
+        std::atomic<uint64_t> maxTicks{0};
+        std::array<std::atomic<uint64_t>, kProfileBuckets> buckets{};
+    };
+
+    struct ProfileSpan {
+        std::atomic<uint64_t> start{0};
+        std::atomic<uint64_t> ticksAndPhase{0};   // duration << 8 | phase
+    };
+
+    struct ThreadProfile {
+        uint32_t tid = 0;
+        std::atomic<bool> owned{true};          // false once the thread exits; the entry is then reused
+        std::array<PhaseCounters, kProfilePhases> phases;
+        std::array<ProfileSpan, kProfileSpans> spans;
+        std::atomic<uint64_t> spanCount{0};
+    };
+
+    //Leaked on purpose: pool threads can still record while statics are destroyed at exit
+    struct ProfileRegistry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadProfile>> threads;
+    };
+
+    static ProfileRegistry& Registry() {
+        static ProfileRegistry* registry = new ProfileRegistry;
+        return *registry;
+    }
+
+    //Clock reading paired with steady_clock at startup, for converting ticks to nanoseconds
+    struct ClockOrigin {
+        uint64_t ticks;
+        std::chrono::steady_clock::time_point time;
+    };
+
+    static uint64_t ReadClock() {
+#if RESOLVER_PROFILE
+        return detail::ProfileClock();
+#else
+        return 0;
+#endif
+    }
+
+    static const ClockOrigin origin{ReadClock(), std::chrono::steady_clock::now()};
+
+    static double NsPerTick() {
+#if RESOLVER_PROFILE && !(defined(__x86_64__) || defined(__i386__))
+        return 1.0;
+#else
+        //A short run since startup would give a noisy rate; wait until the span is long enough
+        auto elapsed = std::chrono::steady_clock::now() - origin.time;
+        if (elapsed < std::chrono::milliseconds(20)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20) - elapsed);
+            elapsed = std::chrono::steady_clock::now() - origin.time;
+        }
+        const uint64_t ticks = ReadClock() - origin.ticks;
+        return ticks ? (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / (double)ticks : 1.0;
+#endif
+    }
+
+#if RESOLVER_PROFILE
+    static void Bump(std::atomic<uint64_t>& a, uint64_t by) {
+        a.store(a.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    static ThreadProfile& AcquireThreadProfile() {
+        ProfileRegistry& r = Registry();
+        std::lock_guard lock(r.mutex);
+        for (auto& t : r.threads) {
+            bool expected = false;
+            if (t->owned.compare_exchange_strong(expected, true)) return *t;
+        }
+        auto t = std::make_unique<ThreadProfile>();
+        t->tid = (uint32_t)r.threads.size();
+        r.threads.push_back(std::move(t));
+        return *r.threads.back();
+    }
+
+    struct LocalProfile {
+        ThreadProfile* profile = nullptr;
+        ~LocalProfile() {
+            if (profile) profile->owned.store(false);
+        }
+    };
+
+    static thread_local LocalProfile localProfile;
+
+    void detail::RecordProbe(ProfilePhase phase, uint64_t start, uint64_t end) {
+        if (!localProfile.profile) localProfile.profile = &AcquireThreadProfile();
+        ThreadProfile& t = *localProfile.profile;
+        const uint64_t ticks = end > start ? end - start : 0;
+
+        PhaseCounters& c = t.phases[(size_t)phase];
+        Bump(c.count, 1);
+        Bump(c.ticks, ticks);
+        if (ticks < c.minTicks.load(std::memory_order_relaxed)) c.minTicks.store(ticks, std::memory_order_relaxed);
+        if (ticks > c.maxTicks.load(std::memory_order_relaxed)) c.maxTicks.store(ticks, std::memory_order_relaxed);
+        Bump(c.buckets[std::bit_width(ticks)], 1);
+
+        const uint64_t n = t.spanCount.load(std::memory_order_relaxed);
+        ProfileSpan& s = t.spans[n % kProfileSpans];
+        s.start.store(start, std::memory_order_relaxed);
+        s.ticksAndPhase.store(ticks << 8 | (uint64_t)phase, std::memory_order_relaxed);
+        t.spanCount.store(n + 1, std::memory_order_release);
+    }
+#endif
+
+    std::array<PhaseProfile, kProfilePhases> CollectProfile() {
+        std::array<PhaseProfile, kProfilePhases> out;
+        std::array<uint64_t, kProfilePhases> ticks{}, minTicks, maxTicks{};
+        minTicks.fill(UINT64_MAX);
+        {
+            ProfileRegistry& r = Registry();
+            std::lock_guard lock(r.mutex);
+            for (const auto& t : r.threads) {
+                for (size_t p = 0; p < kProfilePhases; ++p) {
+                    const PhaseCounters& c = t->phases[p];
+                    out[p].count += c.count.load(std::memory_order_relaxed);
+                    ticks[p] += c.ticks.load(std::memory_order_relaxed);
+                    minTicks[p] = std::min(minTicks[p], c.minTicks.load(std::memory_order_relaxed));
+                    maxTicks[p] = std::max(maxTicks[p], c.maxTicks.load(std::memory_order_relaxed));
+                    for (size_t b = 0; b < kProfileBuckets; ++b) out[p].buckets[b] += c.buckets[b].load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        const double nsPerTick = kProfilingEnabled ? NsPerTick() : 1.0;
+        for (size_t p = 0; p < kProfilePhases; ++p) {
+            PhaseProfile& phase = out[p];
+            phase.nsPerTick = nsPerTick;
+            if (phase.count == 0) continue;
+            phase.totalNs = (double)ticks[p] * nsPerTick;
+            phase.minNs = (double)minTicks[p] * nsPerTick;
+            phase.maxNs = (double)maxTicks[p] * nsPerTick;
+        }
+        return out;
+    }
+
+    void ResetProfile() {
+        ProfileRegistry& r = Registry();
+        std::lock_guard lock(r.mutex);
+        for (auto& t : r.threads) {
+            for (auto& c : t->phases) {
+                c.count.store(0, std::memory_order_relaxed);
+                c.ticks.store(0, std::memory_order_relaxed);
+                c.minTicks.store(UINT64_MAX, std::memory_order_relaxed);
+                c.maxTicks.store(0, std::memory_order_relaxed);
+                for (auto& b : c.buckets) b.store(0, std::memory_order_relaxed);
+            }
+            t->spanCount.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void WriteProfileJson(std::ostream& out) {
+        const auto profile = CollectProfile();
+        json doc;
+        doc["enabled"] = kProfilingEnabled;
+        doc["ns_per_tick"] = profile[0].nsPerTick;
+        doc["phases"] = json::array();
+        for (size_t p = 0; p < kProfilePhases; ++p) {
+            const PhaseProfile& phase = profile[p];
+            json histogram = json::array();
+            for (size_t b = 0; b < kProfileBuckets; ++b) {
+                if (phase.buckets[b] == 0) continue;
+                const double upper = b == 0 ? 0.0 : b >= 64 ? (double)UINT64_MAX : (double)((uint64_t(1) << b) - 1);
+                histogram.push_back({{"le_ns", upper * phase.nsPerTick}, {"count", phase.buckets[b]}});
+            }
+            doc["phases"].push_back({{"name", ProfilePhaseName((ProfilePhase)p)}, {"count", phase.count},
+                                     {"total_ns", phase.totalNs}, {"mean_ns", phase.MeanNs()},
+                                     {"min_ns", phase.minNs}, {"p50_ns", phase.PercentileNs(0.50)},
+                                     {"p90_ns", phase.PercentileNs(0.90)}, {"p99_ns", phase.PercentileNs(0.99)},
+                                     {"max_ns", phase.maxNs}, {"histogram", std::move(histogram)}});
+        }
+        out << doc.dump(2) << "\n";
+    }
+
+    void WriteChromeTrace(std::ostream& out) {
+        const double usPerTick = (kProfilingEnabled ? NsPerTick() : 1.0) / 1000.0;
+        json events = json::array();
+        {
+            ProfileRegistry& r = Registry();
+            std::lock_guard lock(r.mutex);
+            for (const auto& t : r.threads) {
+                const uint64_t n = t->spanCount.load(std::memory_order_acquire);
+                for (uint64_t i = n > kProfileSpans ? n - kProfileSpans : 0; i < n; ++i) {
+                    const ProfileSpan& s = t->spans[i % kProfileSpans];
+                    const uint64_t start = s.start.load(std::memory_order_relaxed);
+                    const uint64_t packed = s.ticksAndPhase.load(std::memory_order_relaxed);
+                    const auto phase = (ProfilePhase)std::min<uint64_t>(packed & 0xff, kProfilePhases);
+                    events.push_back({{"name", ProfilePhaseName(phase)}, {"ph", "X"}, {"pid", 1}, {"tid", t->tid},
+                                      {"ts", (double)(start - origin.ticks) * usPerTick},
+                                      {"dur", (double)(packed >> 8) * usPerTick}});
+                }
+            }
+        }
+        out << json{{"traceEvents", std::move(events)}, {"displayTimeUnit", "ns"}}.dump() << "\n";
+    }
+
+}
@@ -0,0 +1,270 @@
+#include "resolver/Replay.h"
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+
+namespace res {
+
+    static constexpr char kReplayMagic[8] = {'R', 'E', 'S', 'R', 'P', 'L', 'Y', '\0'};
+
+    static uint64_t Mix(uint64_t h, uint64_t v) {
+        constexpr uint64_t kPrime = 1099511628211ull;
+        return (h ^ v) * kPrime;
+    }
+
+    uint64_t ReplayStateHash(const World& world) {
+        uint64_t h = 14695981039346656037ull;
+        for (uint32_t row = 0; row < (uint32_t)world.Size(); ++row) {
+            h = Mix(h, world.ids[row]);
+            h = Mix(h, (uint32_t)world.hp[row]);
+            h = Mix(h, (uint32_t)world.armor[row]);
+            h = Mix(h, (uint32_t)world.power[row]);
+            h = Mix(h, world.tags[row]);
+            for (const auto& si : world.Statuses(row)) {
+                h = Mix(h, si.status);
+                h = Mix(h, (uint32_t)si.stacks);
+                h = Mix(h, (uint32_t)si.remainingTurns);
+            }
+        }
+        return h;
+    }
+
+    ReplayRecorder::ReplayRecorder(const std::string& path, const World& initial, uint64_t dbVersion, uint32_t every)
+        : file(path, std::ios::binary | std::ios::trunc), lastDbVersion(dbVersion), checkpointEvery(every) {
+        if (!file) throw std::runtime_error("Failed to open file for writing: " + path);
+        buffer.append(kReplayMagic, sizeof(kReplayMagic));
+        Put(kReplayFormatVersion);
+        buffer.push_back((char)ReplayEntry::DbVersion);
+        Put(dbVersion);
+        PutWorld(initial);
+    }
+
+    ReplayRecorder::~ReplayRecorder() {
+        Flush();
+    }
+
+    void ReplayRecorder::Put(uint64_t v) {
+        while (v >= 0x80) {
+            buffer.push_back((char)(v | 0x80));
+            v >>= 7;
+        }
+        buffer.push_back((char)v);
+    }
+
+    void ReplayRecorder::PutWorld(const World& world) {
+        buffer.push_back((char)ReplayEntry::World);
+        Put(world.Size());
+        for (uint32_t row = 0; row < (uint32_t)world.Size(); ++row) {
+            Put(world.ids[row]);
+            PutSigned(world.hp[row]);
+            PutSigned(world.armor[row]);
+            PutSigned(world.power[row]);
+            Put(world.tags[row]);
+            const StatusList statuses = world.Statuses(row);
+            Put(statuses.size());
+            for (const auto& si : statuses) {
+                Put(si.status);
+                PutSigned(si.stacks);
+                PutSigned(si.remainingTurns);
+            }
+        }
+        MaybeFlush();
+    }
+
+    void ReplayRecorder::Resolve(const ResolveRequest& req, uint64_t dbVersion) {
+        if (dbVersion != lastDbVersion) {
+            buffer.push_back((char)ReplayEntry::DbVersion);
+            Put(dbVersion);
+            lastDbVersion = dbVersion;
+        }
+        buffer.push_back((char)ReplayEntry::Resolve);
+        Put(req.ability);
+        Put(req.caster);
+        Put(req.targets.size());
+        for (EntityId t : req.targets) Put(t);
+        ++ops;
+        MaybeFlush();
+    }
+
+    void ReplayRecorder::Tick() {
+        buffer.push_back((char)ReplayEntry::Tick);
+        ++ops;
+        MaybeFlush();
+    }
+
+    void ReplayRecorder::AfterTick(const World& world) {
+        ++ticks;
+        if (checkpointEvery != 0 && ticks % checkpointEvery == 0) Checkpoint(world);
+    }
+
+    void ReplayRecorder::Checkpoint(const World& world) {
+        const uint64_t h = ReplayStateHash(world);
+        buffer.push_back((char)ReplayEntry::Checkpoint);
+        char raw[8];
+        std::memcpy(raw, &h, sizeof(raw));
+        buffer.append(raw, sizeof(raw));
+        MaybeFlush();
+    }
+
+    void ReplayRecorder::Resync(const World& world) {
+        PutWorld(world);
+    }
+
+    void ReplayRecorder::Flush() {
+        file.write(buffer.data(), (std::streamsize)buffer.size());
+        file.flush();
+        buffer.clear();
+    }
+
+    //Bounds-checked cursor over the whole log
+    struct ReplayCursor {
+        const unsigned char* p;
+        const unsigned char* end;
+
+        [[noreturn]] static void Fail(const char* why) { throw std::runtime_error(std::string("Malformed replay log: ") + why); }
+
+        bool Done() const { return p == end; }
+
+        uint8_t Byte() {
+            if (p == end) Fail("truncated entry");
+            return *p++;
+        }
+
+        uint64_t Get() {
+            uint64_t v = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                const uint8_t b = Byte();
+                v |= (uint64_t)(b & 0x7f) << shift;
+                if (!(b & 0x80)) return v;
+            }
+            Fail("varint too long");
+        }
+
+        int GetSigned() {
+            const uint64_t v = Get();
+            return (int)(int64_t)((v >> 1) ^ (~(v & 1) + 1));
+        }
+
+        uint32_t Get32() {
+            const uint64_t v = Get();
+            if (v > UINT32_MAX) Fail("value out of range");
+            return (uint32_t)v;
+        }
+    };
+
+    static World ReadWorld(const Db& db, ReplayCursor& c) {
+        World w;
+        const uint64_t count = c.Get();
+        for (uint64_t i = 0; i < count; ++i) {
+            Entity e;
+            e.id = c.Get32();
+            e.hp = c.GetSigned();
+            e.armor = c.GetSigned();
+            e.power = c.GetSigned();
+            e.tags = c.Get();
+            const uint64_t statuses = c.Get();
+            for (uint64_t k = 0; k < statuses; ++k) {
+                StatusInstance si;
+                si.status = c.Get32();
+                si.stacks = c.GetSigned();
+                si.remainingTurns = c.GetSigned();
+                if (si.status >= db.statuses.size()) ReplayCursor::Fail("unknown status handle");
+                e.statuses.push_back(si);
+            }
+            w.Spawn(std::move(e));
+        }
+        return w;
+    }
+
+    ReplayReport Replay(const Db& db, const std::string& path, const ReplayOptions& opts) {
+        std::ifstream f(path, std::ios::binary);
+        if (!f) throw std::runtime_error("Failed to open file: " + path);
+        const std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+        ReplayCursor c{bytes.data(), bytes.data() + bytes.size()};
+        if (bytes.size() < sizeof(kReplayMagic) || std::memcmp(bytes.data(), kReplayMagic, sizeof(kReplayMagic)) != 0) {
+            ReplayCursor::Fail("bad magic");
+        }
+        c.p += sizeof(kReplayMagic);
+        const uint64_t version = c.Get();
+        if (version != kReplayFormatVersion) {
+            throw std::runtime_error("Replay log format version " + std::to_string(version) + ", expected " +
+                                     std::to_string(kReplayFormatVersion));
+        }
+
+        ReplayReport report;
+        const Resolver resolver(db);
+        ResolutionTrace quiet;
+        quiet.level = TraceLevel::Off;
+        ResolutionTrace traced;
+        ResolveRequest req;
+
+        auto tracing = [&](uint64_t op) { return opts.traceOut && op >= opts.traceFrom && op < opts.traceTo; };
+        auto emit = [&](uint64_t op) {
+            *opts.traceOut << "=== op " << op << " ===\n" << traced.ToString();
+            traced.Clear();
+        };
+
+        while (!c.Done()) {
+            switch ((ReplayEntry)c.Byte()) {
+                case ReplayEntry::World:
+                    report.world = ReadWorld(db, c);
+                    break;
+
+                case ReplayEntry::DbVersion:
+                    report.dbVersions.push_back(c.Get());
+                    break;
+
+                case ReplayEntry::Resolve: {
+                    req.ability = c.Get32();
+                    req.caster = c.Get32();
+                    const uint64_t n = c.Get();
+                    if (n > (uint64_t)(c.end - c.p)) ReplayCursor::Fail("target count past end of log");
+                    req.targets.resize(n);
+                    for (auto& t : req.targets) t = c.Get32();
+
+                    const uint64_t op = report.operations++;
+                    ++report.resolves;
+                    const bool full = tracing(op);
+                    try {
+                        resolver.Resolve(report.world, req, full ? traced : quiet);
+                    } catch (const std::exception&) {
+                        //The recorded call threw the same way; the log keeps whatever it applied first
+                        ++report.failedResolves;
+                    }
+                    quiet.Clear();
+                    if (full) emit(op);
+                    break;
+                }
+
+                case ReplayEntry::Tick: {
+                    const uint64_t op = report.operations++;
+                    ++report.ticks;
+                    const bool full = tracing(op);
+                    report.world.TickTurnStart(db, full ? traced : quiet);
+                    quiet.Clear();
+                    if (full) emit(op);
+                    break;
+                }
+
+                case ReplayEntry::Checkpoint: {
+                    if (c.end - c.p < 8) ReplayCursor::Fail("truncated checkpoint");
+                    uint64_t expected;
+                    std::memcpy(&expected, c.p, 8);
+                    c.p += 8;
+                    ++report.checkpoints;
+                    if (ReplayStateHash(report.world) != expected) {
+                        if (report.mismatches++ == 0) report.firstMismatchOp = report.operations;
+                        if (opts.stopOnMismatch) return report;
+                    }
+                    break;
+                }
+
+                default:
+                    ReplayCursor::Fail("unknown entry kind");
+            }
+        }
+        return report;
+    }
+
+}
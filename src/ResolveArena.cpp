@@ -0,0 +1,30 @@
+#include "resolver/ResolveArena.h"
+
+namespace res {
+
+    ResolveArena::ResolveArena(size_t initialBytes)
+        : buffer(new std::byte[initialBytes]), size(initialBytes) {
+        bump.emplace(buffer.get(), size, &spill);
+    }
+
+    void ResolveArena::Reset() {
+        bump->release();
+        if (spill.bytes > 0) {
+            //Grow to hold the whole last cycle, so the next identical one fits in the buffer
+            size += spill.bytes;
+            spill.bytes = 0;
+            buffer.reset(new std::byte[size]);
+        }
+        bump.emplace(buffer.get(), size, &spill);
+    }
+
+    void* ResolveArena::Spill::do_allocate(size_t n, size_t align) {
+        bytes += n;
+        return std::pmr::new_delete_resource()->allocate(n, align);
+    }
+
+    void ResolveArena::Spill::do_deallocate(void* p, size_t n, size_t align) {
+        std::pmr::new_delete_resource()->deallocate(p, n, align);
+    }
+
+}
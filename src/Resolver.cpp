@@ -1,163 +1,378 @@
 #include "resolver/Resolver.h"
-#include "resolver/Format.h"
+#include "resolver/AllocStats.h"
+#include "resolver/DbRegistry.h"
+#include "resolver/Profile.h"
+#include "resolver/Replay.h"
+#include "resolver/ThreadPool.h"
 #include <algorithm>
-#include <cmath>
+#include <unordered_map>
 
 // NOTE: Resolution trace output is a public, stable contract.
 // Any change must update golden tests intentionally.
 
 namespace res {
 
-    static std::string DamageTypeName(DamageType t) {
-        switch(t) {
-            case DamageType::Physical: return "Physical";
-            case DamageType::Fire: return "Fire";
-            case DamageType::Ice: return "Ice";
-            case DamageType::Poison:return "Poison";
-            }
-        return "Unknown";
-    }
-
-    static bool AbilityHasTag(const AbilityDef& a, const std::string& tag) {
-        return std::find(a.tags.begin(), a.tags.end(), tag) != a.tags.end();
-    }
-
     struct DamageContext {
-        const AbilityDef& ability;
         DamageType damageType;
-        EntityId casterId;
-        EntityId targetId;
+        TagMask abilityTags;
+        TagMask targetStatusTags;
+
+        //Only read to confirm a tag condition that hit kOverflowTag
+        const Db* db;
+        AbilityHandle ability;
+        const World* world;
+        uint32_t targetRow;
     };
 
-    static bool RuleMatches(const ModifierRule &r, const World &world, const Db &db, const DamageContext& ctx) {
+    static bool TargetHasStatusTag(const DamageContext& ctx, const std::string& tag) {
+        for(const StatusInstance si : ctx.world->Statuses(ctx.targetRow)) {
+            if(Db::DefHasTag(ctx.db->GetStatus(si.status), kOverflowTag, tag)) return true;
+        }
+        return false;
+    }
+
+    static bool RuleMatches(const ModifierRule &r, const DamageContext& ctx) {
         if(r.when.incomingDamageType.has_value() && *r.when.incomingDamageType != ctx.damageType) return false;
-        if(r.when.abilityHasTag.has_value() && !AbilityHasTag(ctx.ability, *r.when.abilityHasTag)) return false;
-        if(r.when.targetHasStatusTag.has_value()) {
-            const auto& target = world.Get(ctx.targetId);
-            if(!world.EntityHasAnyStatusWithTag(db, target, *r.when.targetHasStatusTag)) return false;
+        if(r.when.abilityTagMask) {
+            if(!(r.when.abilityTagMask & ctx.abilityTags)) return false;
+            if(r.when.abilityTagMask == kOverflowTag &&
+               !Db::DefHasTag(ctx.db->abilities[ctx.ability], kOverflowTag, *r.when.abilityHasTag)) return false;
+        }
+        if(r.when.targetStatusTagMask) {
+            if(!(r.when.targetStatusTagMask & ctx.targetStatusTags)) return false;
+            if(r.when.targetStatusTagMask == kOverflowTag && !TargetHasStatusTag(ctx, *r.when.targetHasStatusTag)) return false;
         }
         return true;
     }
 
-    static float ApplyHookRules(Hook hook, const Entity& owner, const World& world, const Db& db, const DamageContext& ctx, float value, ResolutionTrace& trace) {
-        for(const auto& si : owner.statuses) {
-            const auto& sdef = db.GetStatus(si.id);
-
-            auto hit = sdef.hooks.find(hook);
-            if(hit == sdef.hooks.end()) continue;
+    static float ApplyHookRules(Hook hook, std::span<const HookEntry> rules, const DamageContext& ctx, float value, ResolutionTrace& trace) {
+        ProfileProbe probe(hook == Hook::OnBeforeDealDamage ? ProfilePhase::DealHooks : ProfilePhase::TakeHooks);
+        for(const auto& h : rules) {
+            //Damage type conditions are already applied by the bucket
+            if(h.conditional && !RuleMatches(*h.rule, ctx)) continue;
 
-            const auto& rules = hit->second;
-            for(const auto& r : rules) {
-                if(!RuleMatches(r, world, db, ctx)) continue;
+            const float before = value;
 
-                const float before = value;
+            //Flat then multiply also scale by stacks
+            value += h.addFlat;
+            value *= h.multiplier;
 
-                //Flat then multiply also scale by stacks
-                value += r.modify.addFlat * (float)si.stacks;
-                value *= std::pow(r.modify.multiplier, (float)si.stacks);
-                trace.Add("Resolving hooks:\nCurrent Status:[" + sdef.id + "] hooks:[" +
-                          std::string(hook == Hook::OnBeforeDealDamage ? "OnBeforeDealDamage" : "OnBeforeTakeDamage") +
-                          "] stacks:[" + std::to_string(si.stacks) +
-                          "]\nDamage value before:[" + FmtFloat(before) + "] after:[" + FmtFloat(value) + "]");
-                trace.Add("------------------------------------------");
+            if(trace.Enabled(TraceLevel::Full)) {
+                TraceEvent ev{TraceEvent::Kind::HookApplied};
+                ev.hook = {h.status, hook, h.stacks, before, value};
+                trace.Add(ev, TraceLevel::Full);
             }
         }
         return value;
     }
 
-    static float EvalAmount(const World &world, const Entity &caster, const ScaledAmount &a)
+    static float ApplyHookRules(Hook hook, uint32_t ownerRow, World& world, const Db& db, const DamageContext& ctx, float value, ResolutionTrace& trace) {
+        return ApplyHookRules(hook, world.HookRules(db, ownerRow, hook, ctx.damageType), ctx, value, trace);
+    }
+
+    //Leading rules whose conditions do not look at the target; they give the same result for
+    //every target of an area effect, so they are applied once.
+    static size_t TargetIndependentPrefix(std::span<const HookEntry> rules) {
+        size_t i = 0;
+        while(i < rules.size() && !(rules[i].conditional && rules[i].rule->when.targetStatusTagMask)) ++i;
+        return i;
+    }
+
+    static float EvalAmount(const World &world, ConstEntityRef caster, const EffectOp &op)
     {
-        const float stat = (float)world.GetStat(caster, a.scalesWith);
-        return a.base + stat * a.scale;
+        ProfileProbe probe(ProfilePhase::EvalAmount);
+        const float stat = (float)world.GetStat(caster, op.scalesWith);
+        return op.base + stat * op.scale;
+    }
+
+    //Armor, the hp write and the trace event for damage whose hooks have all been applied
+    static void ApplyDamage(World& world, EntityRef target, DamageType type, float raw, ResolutionTrace& trace) {
+        ProfileProbe probe(ProfilePhase::Mitigation);
+        int dmg = (int)raw;
+        if(type == DamageType::Physical) {
+            dmg = std::max(0, dmg - target.armor);
+        }
+
+        int before = target.hp;
+        world.SetStat(target, Stat::HP, target.hp - dmg);
+
+        TraceEvent ev{TraceEvent::Kind::Damage};
+        ev.damage = {target.id, type, dmg, before, target.hp};
+        trace.Add(ev);
     }
 
-    ResolutionTrace Resolver::Resolve(World& world, const ResolveRequest& req) const {
-        ResolutionTrace trace;
+    static void ApplyHeal(World& world, EntityRef target, DamageType type, int heal, ResolutionTrace& trace) {
+        int before = target.hp;
+        world.SetStat(target, Stat::HP, target.hp + heal);
 
-        const auto& ability = db.GetAbility(req.abilityId);
-        auto& caster = world.Get(req.caster);
-        trace.Add("------------------------------------------");
-        trace.Add("Resolving ability: [" + ability.id + "] caster id: [" + std::to_string(caster.id) + "]");
-        trace.Add("------------------------------------------");
+        TraceEvent ev{TraceEvent::Kind::Heal};
+        ev.damage = {target.id, type, heal, before, target.hp};
+        trace.Add(ev);
+    }
 
-        //If the target mode is self, make sure we are only targeting ourself, otherwise trace an error.
-        if(ability.targeting.mode == TargetMode::Self) {
-            if(req.targets.size() != 1 || req.targets[0] != req.caster) {
-                trace.Add("Error: Self ability requires target to be the caster");
-                return trace;
+    //Targeting was lowered to a count range and caster checks when the ability was added
+    static bool TargetsValid(const AbilityCode& code, const ResolveRequest& req) {
+        const size_t n = req.targets.size();
+        if(n < code.minTargets || n > code.maxTargets) return false;
+        if(code.casterOnly) return std::all_of(req.targets.begin(), req.targets.end(), [&](EntityId t) { return t == req.caster; });
+        if(code.excludeCaster) return std::find(req.targets.begin(), req.targets.end(), req.caster) == req.targets.end();
+        return true;
+    }
+
+    //Tags past the masked ones share a bit, so removing one of those goes by name
+    static int RemoveByTag(const Db& db, World& world, EntityRef target, const EffectOp& op) {
+        if(op.tagMask == kOverflowTag) return world.RemoveStatusesByTag(db, target, db.tagNames[op.tag], op.maxRemoved);
+        return world.RemoveStatusesByTag(db, target, op.tagMask, op.maxRemoved);
+    }
+
+    static void TraceRemoved(const EffectOp& op, EntityId target, int removed, ResolutionTrace& trace) {
+        TraceEvent ev{TraceEvent::Kind::StatusRemoved};
+        ev.statusRemoved = {op.tag, target, removed};
+        trace.Add(ev);
+    }
+
+    static void TraceApplied(const EffectOp& op, ResolutionTrace& trace) {
+        TraceEvent ev{TraceEvent::Kind::StatusApplied};
+        ev.statusApplied = {op.status, op.duration};
+        trace.Add(ev);
+    }
+
+    //Target rows of the area resolve in progress; per thread, so parallel batch waves never share it
+    static thread_local std::vector<uint32_t> areaRows;
+
+    //Area abilities run effect by effect across all targets. Each effect's caster-side amount and
+    //target independent OnBeforeDealDamage rules are evaluated once, when the effect starts, and
+    //traced once; target-side hooks, armor and hp then run in one pass over the target rows.
+    static void ResolveArea(const Db& db, World& world, const AbilityCode& code, std::span<const EffectOp> ops,
+                            uint32_t casterRow, const ResolveRequest& req, ResolutionTrace& trace) {
+        auto& rows = areaRows;
+        rows.clear();
+        for(EntityId t : req.targets) rows.push_back(world.Get(t).row);
+
+        for(const EffectOp& op : ops) {
+            switch(op.code) {
+
+                case EffectOpCode::Damage: {
+                    DamageContext dctx { op.damageType, code.tagMask, 0, &db, req.ability, &world, 0 };
+                    const float base = EvalAmount(world, world.Row(casterRow), op);
+                    const auto dealRules = world.HookRules(db, casterRow, Hook::OnBeforeDealDamage, op.damageType);
+                    const size_t shared = TargetIndependentPrefix(dealRules);
+                    const float dealt = ApplyHookRules(Hook::OnBeforeDealDamage, dealRules.first(shared), dctx, base, trace);
+
+                    for(uint32_t row : rows) {
+                        dctx.targetStatusTags = world.StatusTags(db, row);
+                        dctx.targetRow = row;
+                        float raw = ApplyHookRules(Hook::OnBeforeDealDamage, dealRules.subspan(shared), dctx, dealt, trace);
+                        raw = ApplyHookRules(Hook::OnBeforeTakeDamage, row, world, db, dctx, raw, trace);
+                        ApplyDamage(world, world.Row(row), op.damageType, raw, trace);
+                    }
+                    break;
+                }
+
+                case EffectOpCode::Heal: {
+                    const int heal = (int)EvalAmount(world, world.Row(casterRow), op);
+                    for(uint32_t row : rows) ApplyHeal(world, world.Row(row), op.damageType, heal, trace);
+                    break;
+                }
+
+                case EffectOpCode::RemoveByTag: {
+                    for(uint32_t row : rows) {
+                        auto target = world.Row(row);
+                        const int removed = RemoveByTag(db, world, target, op);
+                        TraceRemoved(op, target.id, removed, trace);
+                    }
+                    break;
+                }
+
+                case EffectOpCode::ApplyStatus: {
+                    for(uint32_t row : rows) {
+                        world.AddStatus(db, world.Row(row), op.status, op.duration, op.stacks);
+                        TraceApplied(op, trace);
+                    }
+                    break;
+                }
             }
         }
+    }
+
+    //Runs the ability's lowered ops: validated targets, then each op against each target in turn
+    static void ResolveWith(const Db& db, World& world, const ResolveRequest& req, ResolutionTrace& trace) {
+        using Kind = TraceEvent::Kind;
+        AllocScope allocs(ThreadAllocProfile().resolve);
+        ProfileProbe probe(ProfilePhase::Resolve);
+        trace.db = &db;
+
+        const AbilityCode& code = db.GetAbilityCode(req.ability);
+        auto caster = world.Get(req.caster);
+        {
+            TraceEvent ev{Kind::AbilityStart};
+            ev.abilityStart = {req.ability, caster.id};
+            trace.Add(ev);
+        }
 
-        //If the target mode is a single enemy, make sure we are only targeting one, otherwise trace an error.
-        if (ability.targeting.mode == TargetMode::SingleEnemy)
+        bool valid;
         {
-            if (req.targets.size() != 1)
-            {
-                trace.Add("Error: Single enemy ability can only have one target");
-                return trace;
-            }
+            ProfileProbe validationProbe(ProfilePhase::TargetValidation);
+            valid = TargetsValid(code, req);
+        }
+        if(!valid) {
+            TraceEvent ev{Kind::TargetError};
+            ev.targetError = {code.mode};
+            trace.Add(ev);
+            return;
+        }
+
+        const std::span<const EffectOp> ops = db.Ops(code);
+        if(code.area) {
+            ResolveArea(db, world, code, ops, caster.row, req, trace);
+            return;
         }
 
         for(EntityId targetId : req.targets) {
-            auto &target = world.Get(targetId);
+            auto target = world.Get(targetId);
 
-            for(const auto& eff : ability.effects) {
-                switch(eff.kind) {
+            for(const EffectOp& op : ops) {
+                switch(op.code) {
 
-                    case AbilityEffectDef::Kind::Damage: {
-                        float raw = EvalAmount(world, caster, eff.amount);
+                    case EffectOpCode::Damage: {
+                        float raw = EvalAmount(world, caster, op);
 
-                        DamageContext dctx { ability, eff.damageType, req.caster, targetId };
+                        DamageContext dctx { op.damageType, code.tagMask, world.StatusTags(db, target.row), &db, req.ability, &world, target.row };
 
                         // Caster hook modifier
-                        raw = ApplyHookRules(Hook::OnBeforeDealDamage, caster, world, db, dctx, raw, trace);
+                        raw = ApplyHookRules(Hook::OnBeforeDealDamage, caster.row, world, db, dctx, raw, trace);
                         // Target hook modifier
-                        raw = ApplyHookRules(Hook::OnBeforeTakeDamage, target, world, db, dctx, raw, trace);
-
-                        int dmg = (int)raw;
-                        if(eff.damageType == DamageType::Physical) {
-                            dmg = std::max(0, dmg - target.armor);
-                        }
-
-                        int before = target.hp;
-                        target.hp -= dmg;
-                        trace.Add("Resolving Damage:\nAmount:[" + std::to_string(dmg) + " " + DamageTypeName(eff.damageType) +
-                                  "]\nTarget entity:[" + std::to_string(targetId) + "] HP before:[" + std::to_string(before) + 
-                                  "] after:[" + std::to_string(target.hp) + "]");
-                        trace.Add("------------------------------------------");
+                        raw = ApplyHookRules(Hook::OnBeforeTakeDamage, target.row, world, db, dctx, raw, trace);
+
+                        ApplyDamage(world, target, op.damageType, raw, trace);
                         break;
                     }
 
-                    case AbilityEffectDef::Kind::Heal: {
-                        int heal = (int)EvalAmount(world, caster, eff.amount);
-                        int before = target.hp;
-                        target.hp += heal;
-
-                        trace.Add("Effect: Heal " + std::to_string(heal) + " " + DamageTypeName(eff.damageType) +
-                                  " target=" + std::to_string(targetId) + " hp before: " + std::to_string(before) +
-                                  " hp now: " + std::to_string(target.hp));
-                        trace.Add("------------------------------------------");
+                    case EffectOpCode::Heal: {
+                        ApplyHeal(world, target, op.damageType, (int)EvalAmount(world, caster, op), trace);
                         break;
                     }
 
-                    case AbilityEffectDef::Kind::RemoveStatusByTag: {
-                        int removed = world.RemoveStatusesByTag(db, target, eff.tag, eff.maxRemoved);
-                        trace.Add("Effect: Remove Status Tag =" + eff.tag + " removed=" + std::to_string(removed) +
-                                " target=" + std::to_string(targetId));
-                        trace.Add("------------------------------------------");
+                    case EffectOpCode::RemoveByTag: {
+                        const int removed = RemoveByTag(db, world, target, op);
+                        TraceRemoved(op, targetId, removed, trace);
                         break;
                     }
 
-                    case AbilityEffectDef::Kind::ApplyStatus: {
-                        world.AddStatus(db, target, eff.statusId, eff.duration, eff.stacks);
-                        trace.Add("Status applied:[" + eff.statusId + "] for:[" + std::to_string(eff.duration) + "] turns");
-                        trace.Add("------------------------------------------");
+                    case EffectOpCode::ApplyStatus: {
+                        world.AddStatus(db, target, op.status, op.duration, op.stacks);
+                        TraceApplied(op, trace);
                         break;
                     }
                 }
             }
         }
+    }
+
+    DbRegistry::Snapshot Resolver::Pin() const {
+        if(registry) return registry->Acquire();
+        //Non-owning pointer to the fixed Db; copying it costs no atomic operations
+        return {std::shared_ptr<const Db>(std::shared_ptr<const Db>(), db), 0};
+    }
+
+    ResolutionTrace Resolver::Resolve(World& world, const ResolveRequest& req, TraceLevel level, std::pmr::memory_resource* mr) const {
+        ResolutionTrace trace(mr ? mr : std::pmr::get_default_resource(), level);
+        Resolve(world, req, trace);
         return trace;
     }
 
-}
\ No newline at end of file
+    void Resolver::Resolve(World& world, const ResolveRequest& req, ResolutionTrace& trace) const {
+        auto snapshot = Pin();
+        if(world.recorder && !world.Forked()) world.recorder->Resolve(req, snapshot.version);
+        ResolveWith(*snapshot, world, req, trace);
+        trace.pinned = std::move(snapshot.db);
+    }
+
+    std::vector<ResolutionTrace> Resolver::ResolveBatch(World& world, std::span<const ResolveRequest> reqs, TraceLevel level,
+                                                        std::pmr::memory_resource* scratch) const {
+        if(!scratch) scratch = std::pmr::get_default_resource();
+        //One snapshot for the whole batch, so every request sees the same content
+        const auto snapshot = Pin();
+        const Db& db = *snapshot;
+        std::vector<ResolutionTrace> traces(reqs.size());
+
+        //Validate everything up front so a bad request cannot leave the batch half applied
+        for(const auto& req : reqs) {
+            db.GetAbilityCode(req.ability);
+            world.Get(req.caster);
+            for(EntityId t : req.targets) world.Get(t);
+        }
+
+        //Waves keep each entity's requests in submission order, so replaying them serially ends the same
+        if(world.recorder && !world.Forked()) {
+            for(const auto& req : reqs) world.recorder->Resolve(req, snapshot.version);
+        }
+
+        //Assign each request to the first wave after every earlier request touching the same entities.
+        //Requests within a wave are disjoint, and each entity sees its requests in submission order.
+        std::pmr::unordered_map<EntityId, uint32_t> lastWave(scratch);
+        std::pmr::vector<uint32_t> waveOf(reqs.size(), scratch);
+        uint32_t waveCount = 0;
+        for(size_t i = 0; i < reqs.size(); ++i) {
+            const auto& req = reqs[i];
+            uint32_t wave = 0;
+            auto bump = [&](EntityId id) {
+                auto it = lastWave.find(id);
+                if(it != lastWave.end()) wave = std::max(wave, it->second + 1);
+            };
+            bump(req.caster);
+            for(EntityId t : req.targets) bump(t);
+
+            lastWave[req.caster] = wave;
+            for(EntityId t : req.targets) lastWave[t] = wave;
+
+            waveOf[i] = wave;
+            waveCount = std::max(waveCount, wave + 1);
+        }
+
+        //Bucket request indices by wave, preserving submission order inside each wave
+        std::pmr::vector<uint32_t> waveStart(waveCount + 1, 0, scratch);
+        for(uint32_t w : waveOf) ++waveStart[w + 1];
+        for(uint32_t w = 0; w < waveCount; ++w) waveStart[w + 1] += waveStart[w];
+        std::pmr::vector<uint32_t> order(reqs.size(), scratch);
+        {
+            std::pmr::vector<uint32_t> cursor(waveStart.begin(), waveStart.end() - 1, scratch);
+            for(uint32_t i = 0; i < (uint32_t)reqs.size(); ++i) order[cursor[waveOf[i]]++] = i;
+        }
+
+        //Status pool growth is shared world state, so reserve room for every status a wave
+        //can apply before running it; inside the wave each request only writes its own rows.
+        std::pmr::unordered_map<uint32_t, uint32_t> pendingStatuses(scratch);
+        auto reserveWave = [&](uint32_t first, uint32_t last) {
+            pendingStatuses.clear();
+            for(uint32_t k = first; k < last; ++k) {
+                const auto& req = reqs[order[k]];
+                const uint32_t applies = db.GetAbilityCode(req.ability).applyStatusOps;
+                if(applies == 0) continue;
+                for(EntityId t : req.targets) pendingStatuses[world.RowOf(t)] += applies;
+            }
+            for(const auto& [row, extra] : pendingStatuses) world.ReserveStatuses(row, extra);
+        };
+
+        for(uint32_t w = 0; w < waveCount; ++w) {
+            const uint32_t first = waveStart[w];
+            const size_t count = waveStart[w + 1] - first;
+            if(pool && count > 1) reserveWave(first, waveStart[w + 1]);
+            auto run = [&](size_t k) {
+                const uint32_t i = order[first + k];
+                traces[i].level = level;
+                traces[i].pinned = snapshot.db;
+                ResolveWith(db, world, reqs[i], traces[i]);
+            };
+
+            if(pool && count > 1) {
+                pool->ParallelFor(count, run);
+            } else {
+                for(size_t k = 0; k < count; ++k) run(k);
+            }
+        }
+
+        return traces;
+    }
+
+}
@@ -0,0 +1,466 @@
+#include "resolver/Server.h"
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <fcntl.h>
+#include <iterator>
+#include <mutex>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <system_error>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace res {
+
+    static constexpr size_t kReadChunk = 64 * 1024;
+
+    [[noreturn]] static void ThrowErrno(const std::string& what) {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    static sockaddr_un SocketAddress(const std::string& path) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(addr.sun_path))
+            throw std::runtime_error("Bad socket path: '" + path + "'");
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        return addr;
+    }
+
+    //A socket file nobody accepts on is left over from a server that died
+    static void RemoveStaleSocket(const std::string& path, const sockaddr_un& addr) {
+        struct stat st;
+        if (::stat(path.c_str(), &st) != 0 || !S_ISSOCK(st.st_mode)) return;
+        const int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (probe < 0) ThrowErrno("socket");
+        const bool live = ::connect(probe, (const sockaddr*)&addr, sizeof(addr)) == 0;
+        ::close(probe);
+        if (live) throw std::runtime_error("A server is already listening on " + path);
+        ::unlink(path.c_str());
+    }
+
+    struct ResolverServer::Connection {
+        int fd = -1;
+        std::string inbox;                  // event loop only
+        bool peerClosed = false;            // event loop only
+        bool framesWaiting = false;         // event loop only: inbox holds frames held back by maxInFlight
+        std::atomic<uint32_t> inFlight{0};  // requests handed to workers and not answered yet
+
+        std::mutex mutex;                   // guards outbox, which workers append replies to
+        std::string outbox;
+        std::atomic<bool> closed{false};
+
+        bool HasOutput() {
+            std::lock_guard lock(mutex);
+            return !outbox.empty();
+        }
+
+        //Over either cap the event loop stops reading; workers draining it wake the loop
+        bool Backlogged(const ServerOptions& o) {
+            if (inFlight.load() >= o.maxInFlight) return true;
+            std::lock_guard lock(mutex);
+            return outbox.size() >= o.maxOutbox;
+        }
+    };
+
+    struct ResolverServer::Worker {
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::vector<Job> queue;
+        bool stopping = false;
+
+        //Touched only by the worker thread
+        std::unordered_map<uint32_t, World> encounters;
+        ResolutionTrace trace;
+    };
+
+    ResolverServer::ResolverServer(const Db& d, ServerOptions o) : db(d), resolver(d), options(std::move(o)) {
+        if (options.workers == 0) options.workers = 1;
+        if (options.maxInFlight == 0) options.maxInFlight = 1;
+        try {
+            const sockaddr_un addr = SocketAddress(options.socketPath);
+            RemoveStaleSocket(options.socketPath, addr);
+
+            listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (listenFd < 0) ThrowErrno("socket");
+            if (::bind(listenFd, (const sockaddr*)&addr, sizeof(addr)) != 0) ThrowErrno("bind " + options.socketPath);
+            if (::listen(listenFd, SOMAXCONN) != 0) ThrowErrno("listen " + options.socketPath);
+            if (::pipe2(wakeFds, O_NONBLOCK | O_CLOEXEC) != 0) ThrowErrno("pipe");
+
+            dispatch.resize(options.workers);
+            for (unsigned i = 0; i < options.workers; ++i) workers.push_back(std::make_unique<Worker>());
+            for (auto& w : workers) {
+                Worker* worker = w.get();
+                worker->thread = std::thread([this, worker] { WorkerLoop(*worker); });
+            }
+        } catch (...) {
+            Shutdown();
+            throw;
+        }
+    }
+
+    ResolverServer::~ResolverServer() {
+        Shutdown();
+    }
+
+    void ResolverServer::Shutdown() {
+        for (auto& w : workers) {
+            {
+                std::lock_guard lock(w->mutex);
+                w->stopping = true;
+            }
+            w->wake.notify_one();
+        }
+        for (auto& w : workers)
+            if (w->thread.joinable()) w->thread.join();
+        workers.clear();
+
+        for (auto& conn : connections) Close(*conn);
+        connections.clear();
+        if (listenFd >= 0) {
+            ::close(listenFd);
+            ::unlink(options.socketPath.c_str());
+            listenFd = -1;
+        }
+        for (int& fd : wakeFds) {
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+        }
+    }
+
+    void ResolverServer::Stop() {
+        stopping.store(true);
+        Wake();
+    }
+
+    void ResolverServer::Wake() {
+        //A full pipe already holds a pending wakeup
+        const char byte = 0;
+        [[maybe_unused]] const ssize_t n = ::write(wakeFds[1], &byte, 1);
+    }
+
+    void ResolverServer::Run() {
+        std::vector<pollfd> fds;
+        while (!stopping.load()) {
+            fds.clear();
+            fds.push_back({listenFd, POLLIN, 0});
+            fds.push_back({wakeFds[0], POLLIN, 0});
+            //Held back frames do not make the socket readable, so a connection that drained
+            //below its caps is served without waiting
+            int timeout = -1;
+            for (auto& conn : connections) {
+                const bool backlogged = conn->Backlogged(options);
+                short events = conn->peerClosed || backlogged ? 0 : POLLIN;
+                if (conn->HasOutput()) events |= POLLOUT;
+                if (conn->framesWaiting && !backlogged) timeout = 0;
+                fds.push_back({conn->fd, events, 0});
+            }
+
+            if (::poll(fds.data(), fds.size(), timeout) < 0) {
+                if (errno == EINTR) continue;
+                ThrowErrno("poll");
+            }
+            if (fds[1].revents & POLLIN) {
+                char drain[256];
+                while (::read(wakeFds[0], drain, sizeof(drain)) > 0) {}
+            }
+            if (stopping.load()) break;
+
+            //Connections accepted below are polled from the next round on
+            const size_t polled = fds.size() - 2;
+            for (size_t i = 0; i < polled; ++i) {
+                const auto& conn = connections[i];
+                const short revents = fds[i + 2].revents;
+                //After end of stream, a hangup means the peer cannot take replies either
+                if (conn->peerClosed && (revents & (POLLHUP | POLLERR))) Close(*conn);
+                else if (revents & (POLLIN | POLLHUP | POLLERR)) ReadFrom(*conn, conn, revents & (POLLHUP | POLLERR));
+                else if (conn->framesWaiting && !conn->Backlogged(options)) ReadFrom(*conn, conn, false);
+            }
+            if (fds[0].revents & POLLIN) Accept();
+
+            for (size_t i = 0; i < workers.size(); ++i) {
+                if (dispatch[i].empty()) continue;
+                Worker& w = *workers[i];
+                {
+                    std::lock_guard lock(w.mutex);
+                    if (w.queue.empty()) w.queue.swap(dispatch[i]);
+                    else std::move(dispatch[i].begin(), dispatch[i].end(), std::back_inserter(w.queue));
+                }
+                dispatch[i].clear();
+                w.wake.notify_one();
+            }
+
+            //Workers wake the loop when an outbox fills up; writing here also covers replies
+            //that landed while this round was reading
+            for (auto& conn : connections) {
+                if (!conn->closed.load() && conn->HasOutput()) FlushTo(*conn);
+                if (!conn->closed.load() && conn->peerClosed && !conn->framesWaiting && conn->inFlight.load() == 0 &&
+                    !conn->HasOutput())
+                    Close(*conn);
+            }
+            std::erase_if(connections, [](const auto& conn) { return conn->closed.load(); });
+        }
+    }
+
+    void ResolverServer::Accept() {
+        for (;;) {
+            const int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR) continue;
+                return;     // EAGAIN, or a connection that went away before it was accepted
+            }
+            auto conn = std::make_shared<Connection>();
+            conn->fd = fd;
+            connections.push_back(std::move(conn));
+        }
+    }
+
+    //Reads until the socket runs dry or the connection goes over its caps, dispatching as
+    //it goes. After a hangup the peer cannot send more, so the rest is read regardless.
+    void ResolverServer::ReadFrom(Connection& conn, const std::shared_ptr<Connection>& owner, bool hangup) {
+        if (conn.closed.load()) return;
+        for (;;) {
+            if (!DispatchFrames(conn, owner)) return;
+            if (conn.peerClosed || (!hangup && conn.Backlogged(options))) return;
+
+            const size_t at = conn.inbox.size();
+            conn.inbox.resize(at + kReadChunk);
+            const ssize_t n = ::read(conn.fd, conn.inbox.data() + at, kReadChunk);
+            conn.inbox.resize(at + (n > 0 ? (size_t)n : 0));
+            if (n > 0) continue;
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+            //End of stream: answer what was sent, then close. A reset gets no answers.
+            if (n < 0) {
+                Close(conn);
+                return;
+            }
+            conn.peerClosed = true;
+        }
+    }
+
+    //Hands complete frames to the workers up to maxInFlight; returns false if the client was dropped
+    bool ResolverServer::DispatchFrames(Connection& conn, const std::shared_ptr<Connection>& owner) {
+        size_t pos = 0;
+        conn.framesWaiting = false;
+        try {
+            for (;;) {
+                Job job{owner, {}};
+                const size_t used = DecodeFrame(conn.inbox.data() + pos, conn.inbox.size() - pos, job.msg);
+                if (used == 0) break;
+                if (conn.inFlight.load() >= options.maxInFlight) {
+                    conn.framesWaiting = true;
+                    break;
+                }
+                pos += used;
+                conn.inFlight.fetch_add(1);
+                dispatch[job.msg.encounter % workers.size()].push_back(std::move(job));
+            }
+        } catch (const std::exception&) {
+            //Frames after a malformed one cannot be delimited; drop the client
+            Close(conn);
+            return false;
+        }
+        conn.inbox.erase(0, pos);
+        return true;
+    }
+
+    void ResolverServer::FlushTo(Connection& conn) {
+        std::lock_guard lock(conn.mutex);
+        size_t sent = 0;
+        while (sent < conn.outbox.size()) {
+            const ssize_t n = ::send(conn.fd, conn.outbox.data() + sent, conn.outbox.size() - sent, MSG_NOSIGNAL);
+            if (n > 0) {
+                sent += (size_t)n;
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            //The peer is gone; nothing queued for it can be delivered
+            conn.outbox.clear();
+            conn.closed.store(true);
+            ::close(conn.fd);
+            return;
+        }
+        conn.outbox.erase(0, sent);
+    }
+
+    void ResolverServer::Close(Connection& conn) {
+        if (conn.closed.exchange(true)) return;
+        ::close(conn.fd);
+        std::lock_guard lock(conn.mutex);
+        conn.outbox.clear();
+    }
+
+    void ResolverServer::WorkerLoop(Worker& worker) {
+        std::vector<Job> batch;
+        std::string frames;
+        WireMessage reply;
+        for (;;) {
+            {
+                std::unique_lock lock(worker.mutex);
+                worker.wake.wait(lock, [&] { return worker.stopping || !worker.queue.empty(); });
+                if (worker.stopping) return;
+                batch.swap(worker.queue);
+            }
+
+            //Replies are appended once per run of jobs from the same connection, and the
+            //event loop is woken once per batch
+            bool wakeLoop = false;
+            for (size_t i = 0; i < batch.size(); ++i) {
+                Connection& conn = *batch[i].conn;
+                Execute(worker, batch[i].msg, reply);
+                EncodeFrame(reply, frames);
+                const bool runEnds = i + 1 == batch.size() || batch[i + 1].conn.get() != &conn;
+                if (!runEnds) continue;
+
+                size_t answered = 1;
+                while (answered <= i && batch[i - answered].conn.get() == &conn) ++answered;
+                {
+                    //Counted down under the lock, so the loop never sees the count drop before the replies land
+                    std::lock_guard lock(conn.mutex);
+                    if (!conn.closed.load()) {
+                        wakeLoop |= conn.outbox.empty();
+                        conn.outbox.append(frames);
+                    }
+                    conn.inFlight.fetch_sub((uint32_t)answered);
+                }
+                frames.clear();
+            }
+            served.fetch_add(batch.size(), std::memory_order_relaxed);
+            batch.clear();
+            if (wakeLoop) Wake();
+        }
+    }
+
+    void ResolverServer::Execute(Worker& worker, const WireMessage& req, WireMessage& reply) {
+        reply.kind = WireKind::Reply;
+        reply.tag = req.tag;
+        reply.encounter = req.encounter;
+        reply.ok = true;
+        reply.stateHash = 0;
+        reply.text.clear();
+
+        auto encounter = [&]() -> World& {
+            const auto it = worker.encounters.find(req.encounter);
+            if (it == worker.encounters.end()) throw std::out_of_range("Unknown encounter: " + std::to_string(req.encounter));
+            return it->second;
+        };
+
+        //Summary is the cheapest level that still records target errors
+        ResolutionTrace& trace = worker.trace;
+        trace.Clear();
+        trace.level = req.wantTrace ? TraceLevel::Full : TraceLevel::Summary;
+        try {
+            switch (req.kind) {
+                case WireKind::Spawn: {
+                    //Checked before the encounter is created, so a refused spawn leaves nothing behind
+                    const EntityId id = req.entity.id;
+                    if (id > options.maxEntityId)
+                        throw std::out_of_range("Entity id " + std::to_string(id) + " is above the limit of " +
+                                                std::to_string(options.maxEntityId));
+                    for (const auto& si : req.entity.statuses) db.GetStatus(si.status);
+                    const auto it = worker.encounters.find(req.encounter);
+                    if (it != worker.encounters.end() && it->second.Contains(id))
+                        throw std::runtime_error("Entity already exists: " + std::to_string(id));
+                    World& world = worker.encounters[req.encounter];
+                    world.Spawn(req.entity);
+                    reply.stateHash = world.StateHash();
+                    break;
+                }
+                case WireKind::Resolve: {
+                    World& world = encounter();
+                    resolver.Resolve(world, req.request, trace);
+                    reply.stateHash = world.StateHash();
+                    const bool rejected = std::any_of(trace.events.begin(), trace.events.end(), [](const TraceEvent& e) {
+                        return e.kind == TraceEvent::Kind::TargetError;
+                    });
+                    if (rejected) {
+                        reply.ok = false;
+                        reply.text = req.wantTrace ? trace.ToString() : "Invalid targets";
+                        return;
+                    }
+                    break;
+                }
+                case WireKind::Tick: {
+                    World& world = encounter();
+                    world.TickTurnStart(db, trace);
+                    reply.stateHash = world.StateHash();
+                    break;
+                }
+                case WireKind::EndEncounter:
+                    if (worker.encounters.erase(req.encounter) == 0)
+                        throw std::out_of_range("Unknown encounter: " + std::to_string(req.encounter));
+                    break;
+                case WireKind::Reply:
+                    throw std::runtime_error("Unexpected Reply from a client");
+            }
+            if (req.wantTrace) reply.text = trace.ToString();
+        } catch (const std::exception& e) {
+            reply.ok = false;
+            reply.text = e.what();
+        }
+    }
+
+    ResolverClient::ResolverClient(const std::string& socketPath) {
+        const sockaddr_un addr = SocketAddress(socketPath);
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) ThrowErrno("socket");
+        if (::connect(fd, (const sockaddr*)&addr, sizeof(addr)) != 0) {
+            const int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "connect " + socketPath);
+        }
+    }
+
+    ResolverClient::~ResolverClient() {
+        if (fd >= 0) ::close(fd);
+    }
+
+    void ResolverClient::Flush() {
+        size_t sent = 0;
+        while (sent < out.size()) {
+            const ssize_t n = ::send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                ThrowErrno("send");
+            }
+            sent += (size_t)n;
+        }
+        out.clear();
+    }
+
+    WireMessage ResolverClient::Receive() {
+        Flush();
+        WireMessage m;
+        for (;;) {
+            const size_t used = DecodeFrame(in.data() + inPos, in.size() - inPos, m);
+            if (used != 0) {
+                inPos += used;
+                if (inPos == in.size()) {
+                    in.clear();
+                    inPos = 0;
+                }
+                return m;
+            }
+            if (inPos > 0) {
+                in.erase(0, inPos);
+                inPos = 0;
+            }
+            const size_t at = in.size();
+            in.resize(at + kReadChunk);
+            const ssize_t n = ::read(fd, in.data() + at, kReadChunk);
+            in.resize(at + (n > 0 ? (size_t)n : 0));
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) ThrowErrno("read");
+            if (n == 0) throw std::runtime_error("Server closed the connection");
+        }
+    }
+
+}
@@ -0,0 +1,452 @@
+#include "resolver/Sim.h"
+#include "resolver/Resolver.h"
+#include "resolver/ThreadPool.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace res {
+
+    using json = nlohmann::json;
+
+    static RotationPolicy ParseRotation(const std::string& s) {
+        if (s == "Cycle") return RotationPolicy::Cycle;
+        if (s == "Random") return RotationPolicy::Random;
+        throw std::runtime_error("Unknown rotation policy: " + s);
+    }
+
+    static TargetPolicy ParseTargeting(const std::string& s) {
+        if (s == "Random") return TargetPolicy::Random;
+        if (s == "LowestHp") return TargetPolicy::LowestHp;
+        throw std::runtime_error("Unknown targeting policy: " + s);
+    }
+
+    static SimCombatant ParseCombatant(const Db& db, const json& jc) {
+        SimCombatant c;
+        c.entity.id = jc.at("id").get<EntityId>();
+        c.entity.hp = jc.value("hp", c.entity.hp);
+        c.entity.armor = jc.value("armor", c.entity.armor);
+        c.entity.power = jc.value("power", c.entity.power);
+        c.team = jc.value("team", 0u);
+        c.rotation = ParseRotation(jc.value("rotation", std::string("Cycle")));
+        c.targeting = ParseTargeting(jc.value("targeting", std::string("Random")));
+
+        if (jc.contains("statuses")) {
+            for (const auto& js : jc.at("statuses")) {
+                c.entity.statuses.push_back({db.FindStatus(js.at("id").get<std::string>()),
+                                             js.value("stacks", 1), js.value("duration", 1)});
+            }
+        }
+
+        //Weights are all or nothing, so a plain name among weighted ones is an error
+        bool weighted = false;
+        for (const auto& ja : jc.at("abilities")) {
+            if (ja.is_string()) {
+                c.abilities.push_back(db.FindAbility(ja.get<std::string>()));
+                continue;
+            }
+            c.abilities.push_back(db.FindAbility(ja.at("id").get<std::string>()));
+            if (ja.contains("weight")) {
+                weighted = true;
+                c.weights.resize(c.abilities.size() - 1, 0);
+                c.weights.push_back(ja.at("weight").get<uint32_t>());
+            }
+        }
+        if (weighted && c.weights.size() != c.abilities.size())
+            throw std::runtime_error("Combatant " + std::to_string(c.entity.id) + " gives weights to only some abilities");
+        return c;
+    }
+
+    EncounterSpec ParseEncounterSpec(const Db& db, std::string_view text) {
+        EncounterSpec spec;
+        try {
+            const json js = json::parse(text.begin(), text.end());
+            spec.maxTurns = js.value("maxTurns", spec.maxTurns);
+            for (const auto& jc : js.at("combatants")) spec.combatants.push_back(ParseCombatant(db, jc));
+        } catch (const json::exception& ex) {
+            throw std::runtime_error(std::string("Failed to parse encounter: ") + ex.what());
+        }
+        return spec;
+    }
+
+    EncounterSpec LoadEncounterSpec(const Db& db, const std::string& path) {
+        std::ifstream f(path);
+        if (!f) throw std::runtime_error("Failed to open file: " + path);
+        std::ostringstream text;
+        text << f.rdbuf();
+        return ParseEncounterSpec(db, text.str());
+    }
+
+    void SimDistribution::Add(uint64_t v) {
+        ++count;
+        sum += v;
+        min = std::min(min, v);
+        max = std::max(max, v);
+        if (v / bucketWidth >= kMaxBuckets) {
+            uint64_t width = bucketWidth;
+            while (v / width >= kMaxBuckets) width *= 2;
+            Widen(width);
+        }
+        const size_t b = (size_t)(v / bucketWidth);
+        if (b >= buckets.size()) buckets.resize(b + 1);
+        ++buckets[b];
+    }
+
+    //Widths are powers of two, so a sample's bucket at any width follows from its bucket at a
+    //narrower one and the merged histogram is the one a single pass would have built
+    void SimDistribution::Widen(uint64_t width) {
+        const uint64_t factor = width / bucketWidth;
+        std::vector<uint64_t> wider((buckets.size() + factor - 1) / factor);
+        for (size_t b = 0; b < buckets.size(); ++b) wider[b / factor] += buckets[b];
+        buckets = std::move(wider);
+        bucketWidth = width;
+    }
+
+    void SimDistribution::Merge(const SimDistribution& o) {
+        if (o.count == 0) return;
+        if (o.bucketWidth > bucketWidth) Widen(o.bucketWidth);
+        const uint64_t factor = bucketWidth / o.bucketWidth;
+        for (size_t b = 0; b < o.buckets.size(); ++b) {
+            if (o.buckets[b] == 0) continue;
+            const size_t at = (size_t)(b / factor);
+            if (at >= buckets.size()) buckets.resize(at + 1);
+            buckets[at] += o.buckets[b];
+        }
+        count += o.count;
+        sum += o.sum;
+        min = std::min(min, o.min);
+        max = std::max(max, o.max);
+    }
+
+    uint64_t SimDistribution::Percentile(double p) const {
+        if (count == 0) return 0;
+        const uint64_t rank = std::max<uint64_t>(1, (uint64_t)(p * (double)count + 0.5));
+        uint64_t seen = 0;
+        for (size_t b = 0; b < buckets.size(); ++b) {
+            seen += buckets[b];
+            if (seen >= rank) return std::min(((uint64_t)b + 1) * bucketWidth - 1, max);
+        }
+        return max;
+    }
+
+    namespace {
+
+        // SplitMix64: one 64-bit add per draw, and streams seeded from consecutive
+        // encounter indices are decorrelated by the output mix.
+        struct SimRng {
+            uint64_t state;
+
+            SimRng(uint64_t seed, uint64_t stream) : state(seed) { state = Next() ^ stream * 0xd1b54a32d192ed03ull; }
+
+            uint64_t Next() {
+                uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+                return z ^ (z >> 31);
+            }
+
+            // Uniform in [0, n) by multiply-shift; the bias is below 2^-32.
+            uint32_t Below(uint32_t n) { return (uint32_t)(((Next() >> 32) * n) >> 32); }
+        };
+
+        // Validated spec plus the spawned starting world every encounter forks from.
+        struct SimPlan {
+            const Db& db;
+            const EncounterSpec& spec;
+            World initial;
+            std::vector<uint32_t> rows;         // per combatant
+            std::vector<uint32_t> totalWeight;  // per combatant, Random rotations only
+            uint32_t teams = 0;
+
+            SimPlan(const Db& d, const EncounterSpec& s);
+        };
+
+        SimPlan::SimPlan(const Db& d, const EncounterSpec& s) : db(d), spec(s) {
+            if (spec.maxTurns <= 0) throw std::runtime_error("Encounter maxTurns must be positive");
+            if (spec.combatants.empty()) throw std::runtime_error("Encounter has no combatants");
+
+            for (const auto& c : spec.combatants) {
+                const std::string who = "Combatant " + std::to_string(c.entity.id);
+                if (initial.Contains(c.entity.id)) throw std::runtime_error(who + " is declared twice");
+                if (c.abilities.empty()) throw std::runtime_error(who + " has no abilities");
+                for (AbilityHandle a : c.abilities) db.GetAbilityCode(a);
+                if (!c.weights.empty() && c.weights.size() != c.abilities.size())
+                    throw std::runtime_error(who + " has " + std::to_string(c.weights.size()) + " weights for " +
+                                             std::to_string(c.abilities.size()) + " abilities");
+                uint32_t total = 0;
+                for (uint32_t w : c.weights) total += w;
+                if (!c.weights.empty() && total == 0) throw std::runtime_error(who + " has only zero weights");
+                totalWeight.push_back(total);
+                for (const auto& si : c.entity.statuses) db.GetStatus(si.status);
+                initial.Spawn(c.entity);
+                teams = std::max(teams, c.team + 1);
+            }
+
+            std::vector<uint8_t> present(teams, 0);
+            for (const auto& c : spec.combatants) present[c.team] = 1;
+            if (std::count(present.begin(), present.end(), 1) < 2)
+                throw std::runtime_error("Encounter needs combatants on at least two teams");
+
+            //Rows are final once every combatant is spawned
+            for (const auto& c : spec.combatants) rows.push_back(initial.RowOf(c.entity.id));
+        }
+
+        // Runs a block's encounters on its own copy of the starting world. Each encounter is
+        // a fork of it that is discarded afterwards, which restores only the rows it touched.
+        class EncounterRunner {
+        public:
+            EncounterRunner(const SimPlan& p, SimReport& r)
+                : plan(p), report(r), world(p.initial), resolver(p.db), n(p.spec.combatants.size()),
+                  hp(n), alive(n), aliveOnTeam(p.teams), next(n), dealt(n), taken(n), deathTurn(n) {
+                trace.level = TraceLevel::Off;
+                report.wins.assign(plan.teams, 0);
+                report.combatants.resize(n);
+                for (auto& c : report.combatants) c.statusTurns.assign(plan.db.statuses.size(), 0);
+            }
+
+            void Run(uint64_t seed, uint64_t index);
+
+        private:
+            void ChooseAbility(size_t i);
+            void ChooseTargets(size_t i);
+            void Settle(int turn, size_t dealer);
+            bool Decided() const;
+            void SampleStatuses();
+
+            const SimPlan& plan;
+            SimReport& report;
+            World world;
+            const Resolver resolver;
+            ResolutionTrace trace;
+            ResolveRequest req;
+            SimRng rng{0, 0};
+            const size_t n;
+
+            //Per combatant state of the running encounter
+            std::vector<int> hp;
+            std::vector<uint8_t> alive;
+            std::vector<uint32_t> aliveOnTeam;
+            std::vector<uint32_t> next;         // Cycle position
+            std::vector<uint64_t> dealt;
+            std::vector<uint64_t> taken;
+            std::vector<int> deathTurn;
+            std::vector<uint32_t> candidates;
+        };
+
+        void EncounterRunner::ChooseAbility(size_t i) {
+            const SimCombatant& c = plan.spec.combatants[i];
+            if (c.rotation == RotationPolicy::Cycle) {
+                req.ability = c.abilities[next[i]];
+                next[i] = next[i] + 1 == c.abilities.size() ? 0 : next[i] + 1;
+                return;
+            }
+            if (c.weights.empty()) {
+                req.ability = c.abilities[rng.Below((uint32_t)c.abilities.size())];
+                return;
+            }
+            uint32_t pick = rng.Below(plan.totalWeight[i]);
+            size_t k = 0;
+            while (pick >= c.weights[k]) pick -= c.weights[k++];
+            req.ability = c.abilities[k];
+        }
+
+        //Enemy modes draw from living combatants of other teams, ally modes from the caster's
+        //team; single target and capped Group abilities then choose by the caster's policy
+        void EncounterRunner::ChooseTargets(size_t i) {
+            const SimCombatant& c = plan.spec.combatants[i];
+            const AbilityCode& code = plan.db.GetAbilityCode(req.ability);
+            req.targets.clear();
+            if (code.casterOnly) {
+                req.targets.push_back(c.entity.id);
+                return;
+            }
+
+            const bool allies = code.mode == TargetMode::SingleAlly || code.mode == TargetMode::AllAllies;
+            candidates.clear();
+            for (uint32_t j = 0; j < n; ++j) {
+                if (alive[j] && (plan.spec.combatants[j].team == c.team) == allies) candidates.push_back(j);
+            }
+
+            const size_t want = std::min<size_t>(code.area ? code.maxTargets : 1, candidates.size());
+            if (want < candidates.size()) {
+                if (c.targeting == TargetPolicy::LowestHp) {
+                    std::partial_sort(candidates.begin(), candidates.begin() + (ptrdiff_t)want, candidates.end(),
+                                      [&](uint32_t a, uint32_t b) { return hp[a] != hp[b] ? hp[a] < hp[b] : a < b; });
+                } else {
+                    for (size_t k = 0; k < want; ++k) {
+                        const size_t pick = k + rng.Below((uint32_t)(candidates.size() - k));
+                        std::swap(candidates[k], candidates[pick]);
+                    }
+                }
+            }
+            for (size_t k = 0; k < want; ++k) req.targets.push_back(plan.spec.combatants[candidates[k]].entity.id);
+        }
+
+        //Charges hp lost since the last call to its combatants, and to the dealer when one acted.
+        //Overkill is not counted, and the dead take no further damage.
+        void EncounterRunner::Settle(int turn, size_t dealer) {
+            for (size_t j = 0; j < n; ++j) {
+                const int now = world.hp[plan.rows[j]];
+                if (!alive[j] || now >= hp[j]) {
+                    hp[j] = now;
+                    continue;
+                }
+                const uint64_t lost = (uint64_t)std::min(hp[j] - now, hp[j]);
+                taken[j] += lost;
+                if (dealer < n) dealt[dealer] += lost;
+                hp[j] = now;
+                if (now <= 0) {
+                    alive[j] = 0;
+                    --aliveOnTeam[plan.spec.combatants[j].team];
+                    deathTurn[j] = turn;
+                }
+            }
+        }
+
+        bool EncounterRunner::Decided() const {
+            return std::count_if(aliveOnTeam.begin(), aliveOnTeam.end(), [](uint32_t a) { return a > 0; }) < 2;
+        }
+
+        void EncounterRunner::SampleStatuses() {
+            for (size_t j = 0; j < n; ++j) {
+                if (!alive[j]) continue;
+                auto& out = report.combatants[j];
+                ++out.aliveTurns;
+                for (const StatusInstance si : world.Statuses(plan.rows[j])) ++out.statusTurns[si.status];
+            }
+        }
+
+        void EncounterRunner::Run(uint64_t seed, uint64_t index) {
+            rng = SimRng(seed, index);
+            auto fork = world.Fork();
+
+            std::fill(aliveOnTeam.begin(), aliveOnTeam.end(), 0);
+            for (size_t j = 0; j < n; ++j) {
+                hp[j] = world.hp[plan.rows[j]];
+                alive[j] = hp[j] > 0;
+                if (alive[j]) ++aliveOnTeam[plan.spec.combatants[j].team];
+            }
+            std::fill(next.begin(), next.end(), 0);
+            std::fill(dealt.begin(), dealt.end(), 0);
+            std::fill(taken.begin(), taken.end(), 0);
+            std::fill(deathTurn.begin(), deathTurn.end(), 0);
+
+            int turn = 0;
+            while (!Decided() && turn < plan.spec.maxTurns) {
+                ++turn;
+                world.TickTurnStart(plan.db, trace);
+                ++report.ticks;
+                Settle(turn, n);
+
+                for (size_t i = 0; i < n && !Decided(); ++i) {
+                    if (!alive[i]) continue;
+                    req.caster = plan.spec.combatants[i].entity.id;
+                    ChooseAbility(i);
+                    ChooseTargets(i);
+                    resolver.Resolve(world, req, trace);
+                    ++report.resolves;
+                    Settle(turn, i);
+                }
+                SampleStatuses();
+            }
+
+            ++report.encounters;
+            report.turns.Add((uint64_t)turn);
+            const auto winner = std::find_if(aliveOnTeam.begin(), aliveOnTeam.end(), [](uint32_t a) { return a > 0; });
+            if (Decided() && winner != aliveOnTeam.end()) ++report.wins[(size_t)(winner - aliveOnTeam.begin())];
+            else ++report.draws;
+            for (size_t j = 0; j < n; ++j) {
+                auto& out = report.combatants[j];
+                out.damageDealt.Add(dealt[j]);
+                out.damageTaken.Add(taken[j]);
+                if (deathTurn[j] > 0) out.turnsToDeath.Add((uint64_t)deathTurn[j]);
+            }
+        }
+
+        void MergeReport(SimReport& into, const SimReport& from) {
+            into.encounters += from.encounters;
+            into.resolves += from.resolves;
+            into.ticks += from.ticks;
+            into.draws += from.draws;
+            into.turns.Merge(from.turns);
+            for (size_t t = 0; t < from.wins.size(); ++t) into.wins[t] += from.wins[t];
+            for (size_t j = 0; j < from.combatants.size(); ++j) {
+                auto& a = into.combatants[j];
+                const auto& b = from.combatants[j];
+                a.damageDealt.Merge(b.damageDealt);
+                a.damageTaken.Merge(b.damageTaken);
+                a.turnsToDeath.Merge(b.turnsToDeath);
+                a.aliveTurns += b.aliveTurns;
+                for (size_t s = 0; s < b.statusTurns.size(); ++s) a.statusTurns[s] += b.statusTurns[s];
+            }
+        }
+
+    }
+
+    SimReport Simulate(const Db& db, const EncounterSpec& spec, const SimOptions& opts) {
+        const auto t0 = std::chrono::steady_clock::now();
+        const SimPlan plan(db, spec);
+
+        SimReport report;
+        report.wins.assign(plan.teams, 0);
+        report.combatants.resize(spec.combatants.size());
+        for (auto& c : report.combatants) c.statusTurns.assign(db.statuses.size(), 0);
+
+        //Many more blocks than threads, so threads that drew short fights take further blocks
+        //from the pool's shared counter instead of idling while others finish long ones
+        const uint64_t concurrency = opts.pool ? opts.pool->Concurrency() : 1;
+        const uint64_t blocks = std::max<uint64_t>(1, std::min<uint64_t>((opts.encounters + 63) / 64, concurrency * 32));
+        std::mutex mergeMutex;
+        auto runBlock = [&](size_t b) {
+            SimReport local;
+            EncounterRunner runner(plan, local);
+            const uint64_t begin = opts.encounters * b / blocks, end = opts.encounters * (b + 1) / blocks;
+            for (uint64_t e = begin; e < end; ++e) runner.Run(opts.seed, e);
+            std::lock_guard lock(mergeMutex);
+            MergeReport(report, local);
+        };
+        if (opts.pool) opts.pool->ParallelFor((size_t)blocks, runBlock);
+        else for (size_t b = 0; b < blocks; ++b) runBlock(b);
+
+        report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        return report;
+    }
+
+    static json DistributionJson(const SimDistribution& d) {
+        return {{"count", d.count}, {"mean", d.Mean()}, {"min", d.count ? d.min : 0}, {"p50", d.Percentile(0.50)},
+                {"p90", d.Percentile(0.90)}, {"p99", d.Percentile(0.99)}, {"max", d.max}};
+    }
+
+    void WriteSimReportJson(const Db& db, const EncounterSpec& spec, const SimReport& report, std::ostream& out) {
+        json doc;
+        doc["encounters"] = report.encounters;
+        doc["resolves"] = report.resolves;
+        doc["ticks"] = report.ticks;
+        doc["seconds"] = report.seconds;
+        doc["resolves_per_sec"] = report.seconds > 0 ? (double)report.resolves / report.seconds : 0.0;
+        doc["wins"] = report.wins;
+        doc["draws"] = report.draws;
+        doc["turns"] = DistributionJson(report.turns);
+        doc["combatants"] = json::array();
+        for (size_t j = 0; j < report.combatants.size(); ++j) {
+            const auto& c = report.combatants[j];
+            json uptime = json::object();
+            for (StatusHandle s = 0; s < c.statusTurns.size(); ++s) {
+                if (c.statusTurns[s] > 0) uptime[db.GetStatus(s).id] = c.Uptime(s);
+            }
+            doc["combatants"].push_back({{"id", spec.combatants[j].entity.id}, {"team", spec.combatants[j].team},
+                                         {"damage_dealt", DistributionJson(c.damageDealt)},
+                                         {"damage_taken", DistributionJson(c.damageTaken)},
+                                         {"deaths", c.turnsToDeath.count},
+                                         {"turns_to_death", DistributionJson(c.turnsToDeath)},
+                                         {"alive_turns", c.aliveTurns}, {"status_uptime", std::move(uptime)}});
+        }
+        out << doc.dump(2) << "\n";
+    }
+
+}
@@ -0,0 +1,100 @@
+#include "resolver/ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace res {
+
+    ThreadPool::ThreadPool(unsigned concurrency) {
+        //The caller of ParallelFor is one of the executing threads
+        const unsigned workers = concurrency > 0 ? concurrency - 1 : 0;
+        threads.reserve(workers);
+        for (unsigned i = 0; i < workers; ++i) {
+            threads.emplace_back([this] { WorkerLoop(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    void ThreadPool::WorkerLoop() {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock lock(mutex);
+                wake.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty()) return;
+                job = std::move(queue.front());
+                queue.pop_front();
+            }
+            job();
+        }
+    }
+
+    namespace {
+        // Shared between the caller and helper jobs. Helpers may start after the caller
+        // has already drained every index, so the state outlives the ParallelFor call.
+        struct ForState {
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> done{0};
+            size_t count = 0;
+            const std::function<void(size_t)>* fn = nullptr;
+
+            std::mutex mutex;
+            std::condition_variable finished;
+            std::exception_ptr error;
+
+            void Drain() {
+                for (;;) {
+                    const size_t i = next.fetch_add(1, std::memory_order_relaxed);
+                    if (i >= count) return;
+                    try {
+                        (*fn)(i);
+                    } catch (...) {
+                        std::lock_guard lock(mutex);
+                        if (!error) error = std::current_exception();
+                    }
+                    if (done.fetch_add(1, std::memory_order_acq_rel) + 1 == count) {
+                        std::lock_guard lock(mutex);
+                        finished.notify_all();
+                    }
+                }
+            }
+        };
+    }
+
+    void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& fn) {
+        if (count == 0) return;
+        if (count == 1 || threads.empty()) {
+            for (size_t i = 0; i < count; ++i) fn(i);
+            return;
+        }
+
+        auto state = std::make_shared<ForState>();
+        state->count = count;
+        state->fn = &fn;
+
+        const size_t helpers = std::min(threads.size(), count - 1);
+        {
+            std::lock_guard lock(mutex);
+            for (size_t i = 0; i < helpers; ++i) {
+                queue.emplace_back([state] { state->Drain(); });
+            }
+        }
+        wake.notify_all();
+
+        state->Drain();
+
+        std::unique_lock lock(state->mutex);
+        state->finished.wait(lock, [&] { return state->done.load(std::memory_order_acquire) == count; });
+        if (state->error) std::rethrow_exception(state->error);
+    }
+
+}
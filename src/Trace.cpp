@@ -1,11 +1,159 @@
 #include "resolver/Trace.h"
-#include <sstream>
+#include "resolver/Db.h"
+#include "resolver/Format.h"
+#include "resolver/Profile.h"
+#include "resolver/TraceSink.h"
+#include <charconv>
+#include <stdexcept>
+#include <string_view>
 
 namespace res {
 
+    static const char* kSeparator = "------------------------------------------\n";
+
+    //Appends without building temporary strings, so out's allocator sees every allocation
+    template <typename Str>
+    static void Put(Str& out, std::string_view s) { out.append(s.data(), s.size()); }
+
+    template <typename Str>
+    static void Put(Str& out, const std::string& s) { out.append(s.data(), s.size()); }
+
+    template <typename Str>
+    static void Put(Str& out, const char* s) { Put(out, std::string_view(s)); }
+
+    template <typename Str, typename T>
+    static void PutInteger(Str& out, T v) {
+        char buf[16];
+        out.append(buf, (size_t)(std::to_chars(buf, buf + sizeof(buf), v).ptr - buf));
+    }
+
+    template <typename Str>
+    static void Put(Str& out, int v) { PutInteger(out, v); }
+
+    template <typename Str>
+    static void Put(Str& out, unsigned v) { PutInteger(out, v); }
+
+    //Same text as FmtFloat(v, 2); fixed-point to_chars rounds exactly like printf("%.2f")
+    template <typename Str>
+    static void Put(Str& out, float v) {
+        char buf[64];
+        out.append(buf, (size_t)(std::to_chars(buf, buf + sizeof(buf), (double)v, std::chars_format::fixed, 2).ptr - buf));
+    }
+
+    template <typename Str, typename... Parts>
+    static void Append(Str& out, const Parts&... parts) { (Put(out, parts), ...); }
+
+    static const char* TargetErrorText(TargetMode mode) {
+        switch(mode) {
+            case TargetMode::Self: return "Error: Self ability requires target to be the caster\n";
+            case TargetMode::AllEnemies: return "Error: AllEnemies ability needs at least one target other than the caster\n";
+            case TargetMode::AllAllies: return "Error: AllAllies ability needs at least one target\n";
+            case TargetMode::Group: return "Error: Group ability needs between one and maxTargets targets\n";
+            default: return "Error: Single enemy ability can only have one target\n";
+        }
+    }
+
+    template <typename Str>
+    static void RenderEvent(Str& out, const Db& db, const TraceEvent& e) {
+        using Kind = TraceEvent::Kind;
+        switch(e.kind) {
+            case Kind::AbilityStart:
+                Append(out, kSeparator, "Resolving ability: [", db.GetAbility(e.abilityStart.ability).id, "] caster id: [",
+                       e.abilityStart.caster, "]\n", kSeparator);
+                break;
+
+            case Kind::TargetError:
+                Put(out, TargetErrorText(e.targetError.mode));
+                break;
+
+            case Kind::HookApplied:
+                Append(out, "Resolving hooks:\nCurrent Status:[", db.GetStatus(e.hook.status).id, "] hooks:[",
+                       HookName(e.hook.hook), "] stacks:[", e.hook.stacks,
+                       "]\nDamage value before:[", e.hook.before, "] after:[", e.hook.after, "]\n", kSeparator);
+                break;
+
+            case Kind::Damage:
+                Append(out, "Resolving Damage:\nAmount:[", e.damage.amount, " ", DamageTypeName(e.damage.damageType),
+                       "]\nTarget entity:[", e.damage.target, "] HP before:[", e.damage.hpBefore,
+                       "] after:[", e.damage.hpAfter, "]\n", kSeparator);
+                break;
+
+            case Kind::Heal:
+                Append(out, "Effect: Heal ", e.damage.amount, " ", DamageTypeName(e.damage.damageType),
+                       " target=", e.damage.target, " hp before: ", e.damage.hpBefore,
+                       " hp now: ", e.damage.hpAfter, "\n", kSeparator);
+                break;
+
+            case Kind::StatusApplied:
+                Append(out, "Status applied:[", db.GetStatus(e.statusApplied.status).id, "] for:[",
+                       e.statusApplied.duration, "] turns\n", kSeparator);
+                break;
+
+            case Kind::StatusRemoved:
+                Append(out, "Effect: Remove Status Tag =", db.tagNames[e.statusRemoved.tag], " removed=", e.statusRemoved.removed,
+                       " target=", e.statusRemoved.target, "\n", kSeparator);
+                break;
+
+            case Kind::DotTick:
+                //Non-fire DoTs have always been reported as Poison; kept for trace stability
+                Append(out, "Turn Start! \nEntity: [", e.dot.entity, "] takes [", e.dot.amount,
+                       " ", e.dot.damageType == DamageType::Fire ? "Fire" : "Poison",
+                       "] from ", db.GetStatus(e.dot.status).id, " (", e.dot.stacks, " stacks).\n");
+                break;
+
+            case Kind::StatusExpired:
+                Append(out, "Turn Start: Entity: ", e.expired.entity, " status expired: ",
+                       db.GetStatus(e.expired.status).id, "\n");
+                break;
+        }
+    }
+
+    template <typename Str>
+    static void Render(Str& out, const ResolutionTrace& trace) {
+        ProfileProbe probe(ProfilePhase::TraceFormat);
+        if (trace.events.empty()) return;
+        if (!trace.db) throw std::runtime_error("ResolutionTrace has no Db to render events with");
+        for(const auto& e : trace.events) RenderEvent(out, *trace.db, e);
+    }
+
     std::string ResolutionTrace::ToString() const {
-        std::ostringstream oss;
-        for(const auto& e : events) oss << e.msg << "\n";
-        return oss.str();
+        std::string out;
+        Render(out, *this);
+        return out;
+    }
+
+    std::pmr::string ResolutionTrace::ToString(std::pmr::memory_resource* mr) const {
+        std::pmr::string out(mr);
+        Render(out, *this);
+        return out;
+    }
+
+    //Each event is rendered into one reusable line buffer and written whole
+    static thread_local std::string streamLine;
+
+    static void WriteEvent(TraceSink& out, const Db& db, const TraceEvent& e) {
+        ProfileProbe probe(ProfilePhase::TraceFormat);
+        streamLine.clear();
+        RenderEvent(streamLine, db, e);
+        out.Write(streamLine);
+    }
+
+    void ResolutionTrace::WriteTo(TraceSink& out) const {
+        if (events.empty()) return;
+        if (!db) throw std::runtime_error("ResolutionTrace has no Db to render events with");
+        for(const auto& e : events) WriteEvent(out, *db, e);
+    }
+
+    void ResolutionTrace::Stream(const TraceEvent& e) {
+        if (!db) throw std::runtime_error("ResolutionTrace has no Db to render events with");
+        WriteEvent(*sink, *db, e);
+    }
+
+    void ResolutionTrace::Append(std::span<const TraceEvent> more) {
+        if (sink) {
+            for(const auto& e : more) Stream(e);
+        } else {
+            events.insert(events.end(), more.begin(), more.end());
+        }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,47 @@
+#include "resolver/TraceSink.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace res {
+
+    FileTraceSink::FileTraceSink(const std::string& path)
+        : fd(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)), owned(true) {
+        if (fd < 0) throw std::system_error(errno, std::generic_category(), "open " + path);
+        buffer.reserve(kBufferBytes);
+    }
+
+    FileTraceSink::FileTraceSink(int f) : fd(f) {
+        buffer.reserve(kBufferBytes);
+    }
+
+    FileTraceSink::~FileTraceSink() {
+        //Nowhere to report a failed final flush from a destructor; call Flush to see errors
+        try {
+            Flush();
+        } catch (const std::system_error&) {
+        }
+        if (owned) ::close(fd);
+    }
+
+    void FileTraceSink::Write(std::string_view text) {
+        if (buffer.size() + text.size() > kBufferBytes) Flush();
+        buffer.append(text.data(), text.size());
+    }
+
+    void FileTraceSink::Flush() {
+        size_t written = 0;
+        while (written < buffer.size()) {
+            const ssize_t n = ::write(fd, buffer.data() + written, buffer.size() - written);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                buffer.erase(0, written);
+                throw std::system_error(errno, std::generic_category(), "write trace");
+            }
+            written += (size_t)n;
+        }
+        buffer.clear();
+    }
+
+}
@@ -0,0 +1,175 @@
+#include "resolver/Wire.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace res {
+
+    static constexpr uint8_t kWantTrace = 1;
+
+    static void Put(std::string& out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back((char)(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back((char)v);
+    }
+
+    static void PutSigned(std::string& out, int64_t v) { Put(out, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63)); }
+
+    void EncodeFrame(const WireMessage& m, std::string& out) {
+        const size_t start = out.size();
+        out.append(kWireHeaderBytes, '\0');
+        out.push_back((char)m.kind);
+        Put(out, m.tag);
+        Put(out, m.encounter);
+        switch (m.kind) {
+            case WireKind::Spawn:
+                Put(out, m.entity.id);
+                PutSigned(out, m.entity.hp);
+                PutSigned(out, m.entity.armor);
+                PutSigned(out, m.entity.power);
+                Put(out, m.entity.tags);
+                Put(out, m.entity.statuses.size());
+                for (const auto& si : m.entity.statuses) {
+                    Put(out, si.status);
+                    PutSigned(out, si.stacks);
+                    PutSigned(out, si.remainingTurns);
+                }
+                break;
+            case WireKind::Resolve:
+                out.push_back((char)(m.wantTrace ? kWantTrace : 0));
+                Put(out, m.request.ability);
+                Put(out, m.request.caster);
+                Put(out, m.request.targets.size());
+                for (EntityId t : m.request.targets) Put(out, t);
+                break;
+            case WireKind::Tick:
+                out.push_back((char)(m.wantTrace ? kWantTrace : 0));
+                break;
+            case WireKind::EndEncounter:
+                break;
+            case WireKind::Reply: {
+                out.push_back((char)(m.ok ? 1 : 0));
+                char raw[8];
+                std::memcpy(raw, &m.stateHash, sizeof(raw));
+                out.append(raw, sizeof(raw));
+                Put(out, m.text.size());
+                out.append(m.text);
+                break;
+            }
+        }
+
+        const size_t body = out.size() - start - kWireHeaderBytes;
+        if (body > kMaxWireFrameBytes) {
+            out.resize(start);
+            throw std::runtime_error("Wire frame too large: " + std::to_string(body) + " bytes");
+        }
+        for (size_t i = 0; i < kWireHeaderBytes; ++i) out[start + i] = (char)(body >> (8 * i));
+    }
+
+    //Bounds-checked cursor over one frame body
+    struct WireCursor {
+        const unsigned char* p;
+        const unsigned char* end;
+
+        [[noreturn]] static void Fail(const char* why) { throw std::runtime_error(std::string("Malformed wire frame: ") + why); }
+
+        size_t Left() const { return (size_t)(end - p); }
+
+        uint8_t Byte() {
+            if (p == end) Fail("truncated body");
+            return *p++;
+        }
+
+        uint64_t Get() {
+            uint64_t v = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                const uint8_t b = Byte();
+                v |= (uint64_t)(b & 0x7f) << shift;
+                if (!(b & 0x80)) return v;
+            }
+            Fail("varint too long");
+        }
+
+        int GetSigned() {
+            const uint64_t v = Get();
+            return (int)(int64_t)((v >> 1) ^ (~(v & 1) + 1));
+        }
+
+        uint32_t Get32() {
+            const uint64_t v = Get();
+            if (v > UINT32_MAX) Fail("value out of range");
+            return (uint32_t)v;
+        }
+
+        //Element count that cannot claim more elements than bytes left
+        uint64_t Count() {
+            const uint64_t n = Get();
+            if (n > Left()) Fail("count past end of frame");
+            return n;
+        }
+    };
+
+    size_t DecodeFrame(const char* data, size_t size, WireMessage& m) {
+        if (size < kWireHeaderBytes) return 0;
+        size_t body = 0;
+        for (size_t i = 0; i < kWireHeaderBytes; ++i) body |= (size_t)(unsigned char)data[i] << (8 * i);
+        if (body > kMaxWireFrameBytes) WireCursor::Fail("frame too large");
+        if (size - kWireHeaderBytes < body) return 0;
+
+        const auto* begin = reinterpret_cast<const unsigned char*>(data) + kWireHeaderBytes;
+        WireCursor c{begin, begin + body};
+        const uint8_t kind = c.Byte();
+        if (kind > (uint8_t)WireKind::Reply) WireCursor::Fail("unknown message kind");
+        m.kind = (WireKind)kind;
+        m.tag = c.Get();
+        m.encounter = c.Get32();
+        m.wantTrace = false;
+        switch (m.kind) {
+            case WireKind::Spawn: {
+                m.entity.id = c.Get32();
+                m.entity.hp = c.GetSigned();
+                m.entity.armor = c.GetSigned();
+                m.entity.power = c.GetSigned();
+                m.entity.tags = c.Get();
+                m.entity.statuses.clear();
+                const uint64_t n = c.Count();
+                for (uint64_t i = 0; i < n; ++i) {
+                    StatusInstance si;
+                    si.status = c.Get32();
+                    si.stacks = c.GetSigned();
+                    si.remainingTurns = c.GetSigned();
+                    m.entity.statuses.push_back(si);
+                }
+                break;
+            }
+            case WireKind::Resolve: {
+                m.wantTrace = c.Byte() & kWantTrace;
+                m.request.ability = c.Get32();
+                m.request.caster = c.Get32();
+                const uint64_t n = c.Count();
+                m.request.targets.resize(n);
+                for (auto& t : m.request.targets) t = c.Get32();
+                break;
+            }
+            case WireKind::Tick:
+                m.wantTrace = c.Byte() & kWantTrace;
+                break;
+            case WireKind::EndEncounter:
+                break;
+            case WireKind::Reply: {
+                m.ok = c.Byte() != 0;
+                if (c.Left() < 8) WireCursor::Fail("truncated state hash");
+                std::memcpy(&m.stateHash, c.p, 8);
+                c.p += 8;
+                const uint64_t n = c.Count();
+                m.text.assign(reinterpret_cast<const char*>(c.p), n);
+                c.p += n;
+                break;
+            }
+        }
+        if (c.p != c.end) WireCursor::Fail("trailing bytes");
+        return kWireHeaderBytes + body;
+    }
+
+}
@@ -1,23 +1,468 @@
 #include "resolver/World.h"
+#include "resolver/AllocStats.h"
 #include "resolver/Trace.h"
 #include "resolver/Db.h"
+#include "resolver/Profile.h"
+#include "resolver/Replay.h"
+#include "resolver/ThreadPool.h"
 #include <algorithm>
+#include <climits>
+#include <cmath>
+#include <mutex>
+#include <stdexcept>
 
 namespace res {
 
-    Entity& World::Get(EntityId id) {return entities.at(id); }
-    const Entity& World::Get(EntityId id) const { return entities.at(id); }
-    
-    bool World::HasTag(const Entity& e, const std::string& tag) const {
-        return e.tags.find(tag) != e.tags.end();
+    static constexpr uint32_t kFreeSlot = UINT32_MAX;
+
+    //Pool slots not holding a live status: no stacks, so no DoT, and never expire
+    static constexpr int kNeverExpires = INT_MAX;
+    static_assert(kNeverExpires == ExpiryWheel::kNone, "Rows that never expire stay out of the wheel");
+    static constexpr uint32_t kNotDot = UINT32_MAX;
+    static constexpr uint32_t kMinStatusCapacity = 4;
+
+    static_assert((size_t)DamageType::Poison + 1 == HookTable::kDamageTypes, "HookTable buckets must cover every DamageType");
+
+    //Zobrist-style keys, summed mod 2^64. Values are unbounded, so each (entity, field) gets
+    //a base key plus a step key per unit of value: damage moves the hash by a multiple of one
+    //key instead of swapping out two. Statuses key their expiry turn; World::StateHash turns
+    //that back into remaining turns with one multiply by the clock.
+    static uint64_t Mix64(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    static constexpr uint64_t kStepSalt = 1ull << 32;
+
+    static uint64_t Key(EntityId id, uint64_t field, uint64_t salt) {
+        return Mix64((((uint64_t)id << 32) + field) * 0x9e3779b97f4a7c15ull ^ salt * 0xd6e8feb86659fd93ull);
+    }
+
+    static uint64_t StatStep(EntityId id, Stat s) { return Key(id, (uint64_t)s, kStepSalt); }
+    static uint64_t TurnStep(EntityId id, StatusHandle status) { return Key(id, 4 + (uint64_t)status, kStepSalt); }
+
+    static uint64_t StatKey(EntityId id, Stat s, int v) {
+        return Key(id, (uint64_t)s, 0) + (uint64_t)(int64_t)v * StatStep(id, s);
+    }
+
+    static uint64_t StatusKey(EntityId id, StatusHandle status, int stacks, int expiry) {
+        return Key(id, 4 + (uint64_t)status, (uint32_t)stacks) + (uint64_t)(int64_t)expiry * TurnStep(id, status);
+    }
+
+    static uint64_t SlotKey(const World& w, EntityId id, uint32_t k) {
+        return StatusKey(id, w.statusDef[k], w.statusStacks[k], w.statusExpiry[k]);
+    }
+
+    static uint64_t RowKey(const World& w, uint32_t row) {
+        const EntityId id = w.ids[row];
+        uint64_t h = StatKey(id, Stat::HP, w.hp[row]) + StatKey(id, Stat::Armor, w.armor[row]) +
+                     StatKey(id, Stat::Power, w.power[row]);
+        const StatusRange& r = w.statusRange[row];
+        for (uint32_t k = r.begin; k < r.begin + r.count; ++k) h += SlotKey(w, id, k);
+        return h;
+    }
+
+    static uint64_t RowTurnSteps(const World& w, uint32_t row) {
+        const StatusRange& r = w.statusRange[row];
+        uint64_t h = 0;
+        for (uint32_t k = r.begin; k < r.begin + r.count; ++k) h += TurnStep(w.ids[row], w.statusDef[k]);
+        return h;
+    }
+
+    //Turn a status with this many turns left expires at, saturating for effectively permanent ones
+    static int ExpiryAt(int turn, int remaining) {
+        return (int)std::min<int64_t>((int64_t)turn + remaining, kNeverExpires);
+    }
+
+    static int RowExpiry(const World& w, uint32_t row) {
+        const StatusRange& r = w.statusRange[row];
+        int expiry = kNeverExpires;
+        for (uint32_t k = r.begin; k < r.begin + r.count; ++k) expiry = std::min(expiry, w.statusExpiry[k]);
+        return expiry;
+    }
+
+    static int DueTurn(const World& w, int expiry) {
+        return expiry == kNeverExpires ? kNeverExpires : std::max(expiry, w.turn + 1);
+    }
+
+    static void FileSlot(World& w, uint32_t slot, int due) {
+        if (due == kNeverExpires) w.expiryWheel.Cancel(slot);
+        else w.expiryWheel.Schedule(slot, due, w.turn);
+    }
+
+    //Files the row's slot at expiry, or the next turn if that has passed. Parallel batch waves
+    //touch disjoint rows, so reading the row's own due needs no lock; relinking the wheel does.
+    static void ScheduleAt(World& w, uint32_t row, int expiry) {
+        const uint32_t slot = w.rowSlot[row];
+        const int due = DueTurn(w, expiry);
+        if (due == w.expiryWheel.Due(slot)) return;
+        std::lock_guard lock(w.scheduleLock.mutex);
+        FileSlot(w, slot, due);
+    }
+
+    //A new status can only bring the row's earliest expiry forward
+    static void ScheduleExpiry(World& w, uint32_t row, int expiry) {
+        if (expiry < w.expiryWheel.Due(w.rowSlot[row])) ScheduleAt(w, row, expiry);
+    }
+
+    static void RescheduleRow(World& w, uint32_t row) {
+        ScheduleAt(w, row, RowExpiry(w, row));
+    }
+
+    //Queues the row's DoT set membership to be recomputed at the next tick, when a Db is at hand
+    static void MarkDotDirty(World& w, uint32_t row) {
+        const uint32_t slot = w.rowSlot[row];
+        if (w.slotDotDirty[slot]) return;
+        w.slotDotDirty[slot] = 1;
+        std::lock_guard lock(w.scheduleLock.mutex);
+        w.dotDirty.push_back(slot);
+    }
+
+    static void SetDotMember(World& w, uint32_t slot, bool member) {
+        const uint32_t at = w.slotDotIndex[slot];
+        if (member == (at != kNotDot)) return;
+        if (member) {
+            w.slotDotIndex[slot] = (uint32_t)w.dotSlots.size();
+            w.dotSlots.push_back(slot);
+        } else {
+            const uint32_t last = w.dotSlots.back();
+            w.dotSlots[at] = last;
+            w.slotDotIndex[last] = at;
+            w.dotSlots.pop_back();
+            w.slotDotIndex[slot] = kNotDot;
+        }
+    }
+
+    static bool RowHasDot(const World& w, const Db& db, uint32_t row) {
+        const StatusRange& r = w.statusRange[row];
+        for (uint32_t k = r.begin; k < r.begin + r.count; ++k) {
+            if (db.hasDot[w.statusDef[k]]) return true;
+        }
+        return false;
+    }
+
+    //Brings the DoT set up to date: fully after a content change, otherwise just the dirty slots
+    static void SyncDotSlots(World& w, const Db& db) {
+        if (w.dotBuiltFor != db.stamp.value) {
+            for (const uint32_t slot : w.dotSlots) w.slotDotIndex[slot] = kNotDot;
+            w.dotSlots.clear();
+            for (const uint32_t slot : w.dotDirty) w.slotDotDirty[slot] = 0;
+            w.dotDirty.clear();
+            for (uint32_t row = 0; row < (uint32_t)w.ids.size(); ++row) {
+                if (RowHasDot(w, db, row)) SetDotMember(w, w.rowSlot[row], true);
+            }
+            w.dotBuiltFor = db.stamp.value;
+            return;
+        }
+        for (const uint32_t slot : w.dotDirty) {
+            w.slotDotDirty[slot] = 0;
+            const uint32_t row = w.slotRow[slot];
+            SetDotMember(w, slot, row != kFreeSlot && RowHasDot(w, db, row));
+        }
+        w.dotDirty.clear();
+    }
+
+    //Appends n inert slots to the pool and returns the index of the first
+    static uint32_t GrowStatusPool(World& w, uint32_t n) {
+        const uint32_t at = (uint32_t)w.statusDef.size();
+        w.statusDef.resize(at + n, 0);
+        w.statusStacks.resize(at + n, 0);
+        w.statusExpiry.resize(at + n, kNeverExpires);
+        return at;
+    }
+
+    static void ClearStatusSlots(World& w, uint32_t begin, uint32_t end) {
+        std::fill(w.statusDef.begin() + begin, w.statusDef.begin() + end, 0);
+        std::fill(w.statusStacks.begin() + begin, w.statusStacks.begin() + end, 0);
+        std::fill(w.statusExpiry.begin() + begin, w.statusExpiry.begin() + end, kNeverExpires);
+    }
+
+    static void ReleaseStatusRange(World& w, uint32_t row) {
+        StatusRange& r = w.statusRange[row];
+        ClearStatusSlots(w, r.begin, r.begin + r.capacity);
+        w.statusGarbage += r.capacity;
+        r = {};
+    }
+
+    //Makes sure the row has room for extra more statuses, relocating its range to the end of the pool if needed
+    static void EnsureStatusCapacity(World& w, uint32_t row, uint32_t extra) {
+        StatusRange& r = w.statusRange[row];
+        if (r.count + extra <= r.capacity) return;
+
+        uint32_t cap = std::max(kMinStatusCapacity, r.capacity * 2);
+        while (cap < r.count + extra) cap *= 2;
+
+        if (r.begin + r.capacity == (uint32_t)w.statusDef.size()) {
+            //Range is the pool tail, grow it in place
+            GrowStatusPool(w, cap - r.capacity);
+        } else {
+            const uint32_t at = GrowStatusPool(w, cap);
+            std::copy_n(w.statusDef.begin() + r.begin, r.count, w.statusDef.begin() + at);
+            std::copy_n(w.statusStacks.begin() + r.begin, r.count, w.statusStacks.begin() + at);
+            std::copy_n(w.statusExpiry.begin() + r.begin, r.count, w.statusExpiry.begin() + at);
+            ClearStatusSlots(w, r.begin, r.begin + r.capacity);
+            w.statusGarbage += r.capacity;
+            r.begin = at;
+        }
+        r.capacity = cap;
+
+        if (w.statusGarbage > 1024 && w.statusGarbage * 2 > (uint32_t)w.statusDef.size()) w.CompactStatusPool();
+    }
+
+    static void AppendStatus(World& w, uint32_t row, StatusHandle status, int stacks, int expiry) {
+        EnsureStatusCapacity(w, row, 1);
+        StatusRange& r = w.statusRange[row];
+        const uint32_t k = r.begin + r.count++;
+        w.statusDef[k] = status;
+        w.statusStacks[k] = stacks;
+        w.statusExpiry[k] = expiry;
+        w.hookTables[row].builtFor = 0;
+        w.stateHash.Add(SlotKey(w, w.ids[row], k));
+        w.turnSteps.Add(TurnStep(w.ids[row], status));
+        ScheduleExpiry(w, row, expiry);
+        MarkDotDirty(w, row);
+    }
+
+    //Removes the i-th status of a row, keeping the order of the others
+    static void EraseStatus(World& w, uint32_t row, uint32_t i) {
+        StatusRange& r = w.statusRange[row];
+        const uint32_t k = r.begin + i, end = r.begin + r.count;
+        w.stateHash.Remove(SlotKey(w, w.ids[row], k));
+        w.turnSteps.Remove(TurnStep(w.ids[row], w.statusDef[k]));
+        std::copy(w.statusDef.begin() + k + 1, w.statusDef.begin() + end, w.statusDef.begin() + k);
+        std::copy(w.statusStacks.begin() + k + 1, w.statusStacks.begin() + end, w.statusStacks.begin() + k);
+        std::copy(w.statusExpiry.begin() + k + 1, w.statusExpiry.begin() + end, w.statusExpiry.begin() + k);
+        ClearStatusSlots(w, end - 1, end);
+        r.count -= 1;
+        w.hookTables[row].builtFor = 0;
+        RescheduleRow(w, row);
+        MarkDotDirty(w, row);
+    }
+
+    //Saves a row into the innermost open fork the first time that fork touches it
+    static void TouchRow(World& w, uint32_t row) {
+        if (w.forkEpochs.empty() || w.rowForkEpoch[row] == w.forkEpochs.back()) return;
+        w.rowForkEpoch[row] = w.forkEpochs.back();
+
+        //Expiries are saved as absolute turns; DiscardFork restores the clock with them
+        const StatusRange& r = w.statusRange[row];
+        w.forkSaves.push_back({row, w.hp[row], w.armor[row], w.power[row], w.tags[row],
+                               (uint32_t)w.forkStatuses.size(), r.count});
+        for (uint32_t k = r.begin; k < r.begin + r.count; ++k) {
+            w.forkStatuses.push_back({w.statusDef[k], w.statusStacks[k], w.statusExpiry[k]});
+        }
+    }
+
+    static void RebuildHookTable(const World& w, const Db& db, uint32_t row, HookTable& table) {
+        table.entries.clear();
+        table.statusTags = 0;
+        const StatusRange& r = w.statusRange[row];
+        for (uint32_t k = r.begin; k < r.begin + r.count; ++k) table.statusTags |= db.GetStatus(w.statusDef[k]).tagMask;
+
+        //Each bucket lists, in status order, the rules that can fire for its hook and damage type
+        for (size_t b = 0; b < HookTable::kBuckets; ++b) {
+            table.offsets[b] = (uint32_t)table.entries.size();
+            const Hook hook = (Hook)(b / HookTable::kDamageTypes);
+            const DamageType type = (DamageType)(b % HookTable::kDamageTypes);
+
+            for (uint32_t k = r.begin; k < r.begin + r.count; ++k) {
+                const auto& sdef = db.GetStatus(w.statusDef[k]);
+                auto hit = sdef.hooks.find(hook);
+                if (hit == sdef.hooks.end()) continue;
+
+                const int stacks = w.statusStacks[k];
+                for (const auto& rule : hit->second) {
+                    if (rule.when.incomingDamageType.has_value() && *rule.when.incomingDamageType != type) continue;
+
+                    HookEntry e;
+                    e.rule = &rule;
+                    e.status = w.statusDef[k];
+                    e.stacks = stacks;
+                    e.addFlat = rule.modify.addFlat * (float)stacks;
+                    e.multiplier = std::pow(rule.modify.multiplier, (float)stacks);
+                    e.conditional = (rule.when.abilityTagMask | rule.when.targetStatusTagMask) != 0;
+                    table.entries.push_back(e);
+                }
+            }
+        }
+        table.offsets[HookTable::kBuckets] = (uint32_t)table.entries.size();
+        table.builtFor = db.stamp.value;
+    }
+
+    void IdSlotMap::Insert(EntityId id, uint32_t slot) {
+        if (2 * (size_t)(count + 1) > entries.size()) {
+            std::vector<Entry> grown(std::max<size_t>(16, 2 * entries.size()));
+            const size_t mask = grown.size() - 1;
+            for (const Entry& e : entries) {
+                if (e.slot == kAbsent) continue;
+                size_t i = Home(e.id, mask);
+                while (grown[i].slot != kAbsent) i = (i + 1) & mask;
+                grown[i] = e;
+            }
+            entries.swap(grown);
+        }
+        const size_t mask = entries.size() - 1;
+        size_t i = Home(id, mask);
+        while (entries[i].slot != kAbsent) i = (i + 1) & mask;
+        entries[i] = {id, slot};
+        ++count;
+    }
+
+    void IdSlotMap::Erase(EntityId id) {
+        if (entries.empty()) return;
+        const size_t mask = entries.size() - 1;
+        size_t i = Home(id, mask);
+        while (entries[i].slot != kAbsent && entries[i].id != id) i = (i + 1) & mask;
+        if (entries[i].slot == kAbsent) return;
+
+        //Pull back each later entry of the run whose home does not lie in (hole, j]
+        for (size_t j = (i + 1) & mask; entries[j].slot != kAbsent; j = (j + 1) & mask) {
+            const size_t home = Home(entries[j].id, mask);
+            if (((j - home) & mask) >= ((j - i) & mask)) {
+                entries[i] = entries[j];
+                i = j;
+            }
+        }
+        entries[i] = Entry{};
+        --count;
+    }
+
+    EntityHandle World::Spawn(Entity e) {
+        if (Forked()) throw std::logic_error("Cannot spawn while the world is forked");
+        if (Contains(e.id)) throw std::runtime_error("Entity already exists: " + std::to_string(e.id));
+
+        //Mapping the id first keeps a failed insert from leaving a row nobody can look up
+        const uint32_t slot = freeSlots.empty() ? (uint32_t)slotRow.size() : freeSlots.back();
+        idSlot.Insert(e.id, slot);
+        if (!freeSlots.empty()) {
+            freeSlots.pop_back();
+        } else {
+            slotRow.push_back(0);
+            slotGeneration.push_back(0);
+            expiryWheel.Resize(slotRow.size());
+            slotDotIndex.push_back(kNotDot);
+            slotDotDirty.push_back(0);
+        }
+
+        //Rows stay sorted by id; spawning in increasing id order appends without shifting
+        const uint32_t row = (uint32_t)(std::lower_bound(ids.begin(), ids.end(), e.id) - ids.begin());
+        ids.insert(ids.begin() + row, e.id);
+        hp.insert(hp.begin() + row, e.hp);
+        armor.insert(armor.begin() + row, e.armor);
+        power.insert(power.begin() + row, e.power);
+        tags.insert(tags.begin() + row, e.tags);
+        statusRange.insert(statusRange.begin() + row, StatusRange{});
+        hookTables.insert(hookTables.begin() + row, HookTable{});
+        rowSlot.insert(rowSlot.begin() + row, slot);
+        rowForkEpoch.insert(rowForkEpoch.begin() + row, 0);
+        for (uint32_t r = row; r < (uint32_t)rowSlot.size(); ++r) slotRow[rowSlot[r]] = r;
+
+        stateHash.Add(StatKey(e.id, Stat::HP, e.hp) + StatKey(e.id, Stat::Armor, e.armor) + StatKey(e.id, Stat::Power, e.power));
+        EnsureStatusCapacity(*this, row, (uint32_t)e.statuses.size());
+        for (const auto& si : e.statuses) AppendStatus(*this, row, si.status, si.stacks, ExpiryAt(turn, si.remainingTurns));
+
+        return {slot, slotGeneration[slot]};
+    }
+
+    void World::Despawn(EntityId id) {
+        if (Forked()) throw std::logic_error("Cannot despawn while the world is forked");
+        const uint32_t row = RowOf(id);
+        const uint32_t slot = rowSlot[row];
+
+        stateHash.Remove(RowKey(*this, row));
+        turnSteps.Remove(RowTurnSteps(*this, row));
+        ReleaseStatusRange(*this, row);
+        ids.erase(ids.begin() + row);
+        hp.erase(hp.begin() + row);
+        armor.erase(armor.begin() + row);
+        power.erase(power.begin() + row);
+        tags.erase(tags.begin() + row);
+        statusRange.erase(statusRange.begin() + row);
+        hookTables.erase(hookTables.begin() + row);
+        rowSlot.erase(rowSlot.begin() + row);
+        rowForkEpoch.erase(rowForkEpoch.begin() + row);
+        for (uint32_t r = row; r < (uint32_t)rowSlot.size(); ++r) slotRow[rowSlot[r]] = r;
+
+        slotRow[slot] = kFreeSlot;
+        slotGeneration[slot] += 1;
+        expiryWheel.Cancel(slot);
+        SetDotMember(*this, slot, false);
+        freeSlots.push_back(slot);
+        idSlot.Erase(id);
+    }
+
+    bool World::IsAlive(EntityHandle h) const {
+        return h.index < slotGeneration.size() && slotGeneration[h.index] == h.generation &&
+               slotRow[h.index] != kFreeSlot;
     }
 
-    bool World::HasStatusTag(const Db& db, const StatusInstance& si, const std::string& tag) const {
-        const auto& def = db.GetStatus(si.id);
-        return std::find(def.tags.begin(), def.tags.end(), tag) != def.tags.end();
+    EntityHandle World::HandleOf(EntityId id) const {
+        const uint32_t slot = idSlot.Find(id);
+        if (slot == IdSlotMap::kAbsent) throw std::out_of_range("Unknown entity: " + std::to_string(id));
+        return {slot, slotGeneration[slot]};
     }
 
-    int World::GetStat(const Entity& e, Stat s) const {
+    uint32_t World::RowOf(EntityId id) const {
+        const uint32_t slot = idSlot.Find(id);
+        if (slot == IdSlotMap::kAbsent) throw std::out_of_range("Unknown entity: " + std::to_string(id));
+        return slotRow[slot];
+    }
+
+    uint32_t World::RowOf(EntityHandle h) const {
+        if (!IsAlive(h)) throw std::out_of_range("Stale entity handle: " + std::to_string(h.index));
+        return slotRow[h.index];
+    }
+
+    EntityRef World::Row(uint32_t row) {
+        TouchRow(*this, row);
+        return {ids[row], hp[row], armor[row], power[row], tags[row], Statuses(row), row};
+    }
+
+    ConstEntityRef World::Row(uint32_t row) const {
+        return {ids[row], hp[row], armor[row], power[row], tags[row], Statuses(row), row};
+    }
+
+    Entity World::Snapshot(EntityId id) const {
+        const uint32_t row = RowOf(id);
+        Entity e{ids[row], hp[row], armor[row], power[row], tags[row], {}};
+        for (const auto& si : Statuses(row)) e.statuses.push_back(si);
+        return e;
+    }
+
+    void World::CompactStatusPool() {
+        std::vector<StatusHandle> def;
+        std::vector<int> stacks, turns;
+        size_t total = 0;
+        for (const auto& r : statusRange) total += r.capacity;
+        def.reserve(total);
+        stacks.reserve(total);
+        turns.reserve(total);
+
+        for (auto& r : statusRange) {
+            const uint32_t at = (uint32_t)def.size();
+            def.insert(def.end(), statusDef.begin() + r.begin, statusDef.begin() + r.begin + r.count);
+            stacks.insert(stacks.end(), statusStacks.begin() + r.begin, statusStacks.begin() + r.begin + r.count);
+            turns.insert(turns.end(), statusExpiry.begin() + r.begin, statusExpiry.begin() + r.begin + r.count);
+            def.resize(at + r.capacity, 0);
+            stacks.resize(at + r.capacity, 0);
+            turns.resize(at + r.capacity, kNeverExpires);
+            r.begin = at;
+        }
+
+        statusDef.swap(def);
+        statusStacks.swap(stacks);
+        statusExpiry.swap(turns);
+        statusGarbage = 0;
+    }
+
+    bool World::HasStatusTag(const Db& db, const StatusInstance& si, TagMask tag) const {
+        return (db.GetStatus(si.status).tagMask & tag) != 0;
+    }
+
+    int World::GetStat(ConstEntityRef e, Stat s) const {
         switch(s) {
             case Stat::HP: return e.hp;
             case Stat::Armor: return e.armor;
@@ -26,34 +471,63 @@ namespace res {
         return 0;
     }
 
-    void World::AddStatus(const Db& db, Entity& target, const std::string& statusId, int duration, int stacks) {
-        const auto& def = db.GetStatus(statusId);
+    void World::SetStat(EntityRef e, Stat s, int value) {
+        int& field = s == Stat::HP ? e.hp : s == Stat::Armor ? e.armor : e.power;
+        stateHash.Add(((uint64_t)(int64_t)value - (uint64_t)(int64_t)field) * StatStep(e.id, s));
+        field = value;
+    }
+
+    uint64_t World::RehashState() {
+        uint64_t h = 0, steps = 0;
+        for (uint32_t row = 0; row < (uint32_t)ids.size(); ++row) {
+            h += RowKey(*this, row);
+            steps += RowTurnSteps(*this, row);
+        }
+        stateHash.Store(h);
+        turnSteps.Store(steps);
+        return StateHash();
+    }
+
+    void World::AddStatus(const Db& db, EntityRef target, StatusHandle status, int duration, int stacks) {
+        ProfileProbe probe(ProfilePhase::StatusApply);
+        const auto& def = db.GetStatus(status);
+        const StatusRange& r = statusRange[target.row];
 
         //Check to see if entity already has this status, if so add the stacks and set the duration
-        for(auto& si : target.statuses) {
-            if(si.id == statusId) {
+        for(uint32_t k = r.begin; k < r.begin + r.count; ++k) {
+            if(statusDef[k] == status) {
                 //Dont go above max stacks
-                si.stacks = std::min(def.maxStacks, si.stacks + stacks);
-                si.remainingTurns = std::max(si.remainingTurns, duration);
+                const int newStacks = std::min(def.maxStacks, statusStacks[k] + stacks);
+                if (newStacks != statusStacks[k]) hookTables[target.row].builtFor = 0;
+                const uint64_t before = SlotKey(*this, target.id, k);
+                const int expiry = std::max(statusExpiry[k], ExpiryAt(turn, duration));
+                const bool extended = expiry != statusExpiry[k];
+                statusStacks[k] = newStacks;
+                statusExpiry[k] = expiry;
+                stateHash.Add(SlotKey(*this, target.id, k) - before);
+                //A longer duration can move the row's earliest expiry later
+                if (extended) RescheduleRow(*this, target.row);
                 return;
             }
         }
 
         //If not add a new status instance to the targets statuses
-        StatusInstance si;
-        si.id = statusId;
-        si.stacks = stacks;
-        si.remainingTurns = duration;
-        target.statuses.push_back(std::move(si));
+        AppendStatus(*this, target.row, status, stacks, ExpiryAt(turn, duration));
     }
 
-    int World::RemoveStatusesByTag(const Db& db, Entity& target, const std::string& tag, int maxRemoved) {
+    void World::AddStatus(const Db& db, EntityRef target, const std::string& statusId, int duration, int stacks) {
+        AddStatus(db, target, db.FindStatus(statusId), duration, stacks);
+    }
+
+    template <typename Match>
+    static int RemoveStatusesWhere(World& w, EntityRef target, int maxRemoved, Match matches) {
+        ProfileProbe probe(ProfilePhase::StatusRemove);
         int removed = 0;
-        auto& v = target.statuses;
+        const auto v = target.statuses;
 
         for(int i = (int)v.size() - 1; i >= 0 && removed < maxRemoved; --i) {
-            if (HasStatusTag(db, v[i], tag)) {
-                v.erase(v.begin() + i);
+            if (matches(v[i])) {
+                EraseStatus(w, target.row, (uint32_t)i);
                 ++removed;
             }
         }
@@ -61,32 +535,258 @@ namespace res {
         return removed;
     }
 
-    void World::TickTurnStart(const Db& db, ResolutionTrace& trace) {
-        for(auto& [id, e] : entities) {
+    int World::RemoveStatusesByTag(const Db& db, EntityRef target, TagMask tag, int maxRemoved) {
+        return RemoveStatusesWhere(*this, target, maxRemoved, [&](const StatusInstance& si) { return HasStatusTag(db, si, tag); });
+    }
+
+    int World::RemoveStatusesByTag(const Db& db, EntityRef target, const std::string& tag, int maxRemoved) {
+        const TagMask mask = db.TagMaskOf(tag);
+        if (mask != kOverflowTag) return RemoveStatusesByTag(db, target, mask, maxRemoved);
+        return RemoveStatusesWhere(*this, target, maxRemoved,
+                                   [&](const StatusInstance& si) { return Db::DefHasTag(db.GetStatus(si.status), mask, tag); });
+    }
+
+    //Applies DoT damage and expiries to the listed rows, which must be distinct. Touches only
+    //those rows, their pool ranges and trace, so disjoint lists can run concurrently.
+    static void TickRows(World& w, const Db& db, std::span<const uint32_t> rows, ResolutionTrace& trace) {
+        const bool traced = trace.Enabled(TraceLevel::Summary);
+        const int turn = w.turn;
+        uint64_t hashDelta = 0, turnStepDelta = 0;
+        for (const uint32_t row : rows) {
+            StatusRange& r = w.statusRange[row];
+            if (r.count == 0) continue;
+            TouchRow(w, row);
+            const EntityId id = w.ids[row];
+            const uint32_t begin = r.begin, end = r.begin + r.count;
+
             //Apply damage over time
-            for(auto& si: e.statuses) {
-                const auto& def = db.GetStatus(si.id);
-                if(def.dot.has_value()) {
-                    int dmg = def.dot->perStackBase * si.stacks;
-                    e.hp -= dmg;
-                    trace.Add("Turn Start! \nEntity: [" + std::to_string(id) + "] takes [" + std::to_string(dmg) +
-                    " " + (def.dot->damageType == DamageType::Fire ? "Fire" : "Poison") + 
-                    "] from " + si.id + " (" + std::to_string(si.stacks) + " stacks).");
+            int total = 0;
+            bool anyExpired = false;
+            for (uint32_t k = begin; k < end; ++k) {
+                total += db.dotPerStack[w.statusDef[k]] * w.statusStacks[k];
+                anyExpired |= w.statusExpiry[k] <= turn;
+            }
+            //Surviving statuses keep their key, the clock moves them; expired ones leave the hash
+            if (anyExpired) {
+                for (uint32_t k = begin; k < end; ++k) {
+                    if (w.statusExpiry[k] > turn) continue;
+                    hashDelta -= SlotKey(w, id, k);
+                    turnStepDelta -= TurnStep(id, w.statusDef[k]);
                 }
             }
+            if (total != 0) hashDelta -= (uint64_t)(int64_t)total * StatStep(id, Stat::HP);
+            w.hp[row] -= total;
 
-            // Decrement status durations
-            for (int i = (int)e.statuses.size() - 1; i >= 0; i--) {
-                e.statuses[i].remainingTurns -= 1;
-                if(e.statuses[i].remainingTurns <= 0) {
-                    trace.Add("Turn Start: Entity: " + std::to_string(id) + " status expired: " + e.statuses[i].id);
-                    e.statuses.erase(e.statuses.begin() + i);
+            if (traced) {
+                for (uint32_t k = begin; k < end; ++k) {
+                    const StatusHandle h = w.statusDef[k];
+                    if (!db.hasDot[h]) continue;
+                    TraceEvent ev{TraceEvent::Kind::DotTick};
+                    ev.dot = {id, h, db.GetStatus(h).dot->damageType, db.dotPerStack[h] * w.statusStacks[k], w.statusStacks[k]};
+                    trace.Add(ev);
                 }
             }
+            if (!anyExpired) continue;
+
+            //Expiries are reported last to first, as the scalar loop used to erase them
+            if (traced) {
+                for (uint32_t k = end; k-- > begin;) {
+                    if (w.statusExpiry[k] > turn) continue;
+                    TraceEvent ev{TraceEvent::Kind::StatusExpired};
+                    ev.expired = {id, w.statusDef[k]};
+                    trace.Add(ev);
+                }
+            }
+
+            //Compact the surviving statuses in place, keeping their order
+            uint32_t out = begin;
+            for (uint32_t k = begin; k < end; ++k) {
+                if (w.statusExpiry[k] <= turn) continue;
+                w.statusDef[out] = w.statusDef[k];
+                w.statusStacks[out] = w.statusStacks[k];
+                w.statusExpiry[out] = w.statusExpiry[k];
+                ++out;
+            }
+            ClearStatusSlots(w, out, end);
+            r.count = out - begin;
+            w.hookTables[row].builtFor = 0;
+        }
+        w.stateHash.Add(hashDelta);
+        w.turnSteps.Add(turnStepDelta);
+    }
+
+    //Below this many rows per chunk the pool hand-off costs more than the tick itself
+    static constexpr uint32_t kMinTickChunkRows = 256;
+
+    void World::TickTurnStart(const Db& db, ResolutionTrace& trace, ThreadPool* pool) {
+        AllocScope allocs(ThreadAllocProfile().tick);
+        ProfileProbe probe(ProfilePhase::Tick);
+        trace.db = &db;
+        const bool recording = recorder && !Forked();
+        if (recording) recorder->Tick();
+
+        turn += 1;
+        {
+            ProfileProbe collectProbe(ProfilePhase::TickCollect);
+            SyncDotSlots(*this, db);
+
+            //Rows with a DoT, plus rows whose earliest expiry came up; collecting unschedules them
+            const uint32_t rows = (uint32_t)ids.size();
+            tickMarks.resize(rows, 0);
+            tickRows.clear();
+            auto add = [&](uint32_t row) {
+                if (tickMarks[row]) return;
+                tickMarks[row] = 1;
+                tickRows.push_back(row);
+            };
+            for (const uint32_t slot : dotSlots) add(slotRow[slot]);
+            dueSlots.clear();
+            expiryWheel.Collect(turn, dueSlots);
+            for (const uint32_t slot : dueSlots) add(slotRow[slot]);
+
+            //Ascending rows keep the trace in EntityId order: a short list is sorted, a long one
+            //read back off the marks
+            if (tickRows.size() * 16 < rows) {
+                std::sort(tickRows.begin(), tickRows.end());
+                for (const uint32_t row : tickRows) tickMarks[row] = 0;
+            } else {
+                tickRows.clear();
+                for (uint32_t row = 0; row < rows; ++row) {
+                    if (tickMarks[row]) tickRows.push_back(row);
+                }
+                std::fill(tickMarks.begin(), tickMarks.end(), 0);
+            }
+        }
+
+        //The fork journal is shared, so forked ticks stay on this thread
+        const uint32_t count = (uint32_t)tickRows.size();
+        const uint32_t chunks = pool && !Forked()
+            ? std::min(pool->Concurrency() * 4, count / kMinTickChunkRows) : 0;
+        {
+            ProfileProbe rowsProbe(ProfilePhase::TickRows);
+            if (chunks < 2) {
+                TickRows(*this, db, tickRows, trace);
+            } else {
+                //Each chunk traces into its own buffer and the buffers are appended in chunk order,
+                //so the trace matches a serial tick
+                if (tickTraces.size() < chunks) tickTraces.resize(chunks);
+                pool->ParallelFor(chunks, [&](size_t c) {
+                    ResolutionTrace& local = tickTraces[c];
+                    local.Clear();
+                    local.level = trace.level;
+                    local.db = &db;
+                    const uint32_t first = (uint32_t)((uint64_t)count * c / chunks);
+                    const uint32_t last = (uint32_t)((uint64_t)count * (c + 1) / chunks);
+                    TickRows(*this, db, std::span<const uint32_t>(tickRows).subspan(first, last - first), local);
+                });
+                for (uint32_t c = 0; c < chunks; ++c) trace.Append(tickTraces[c].events);
+            }
+        }
+
+        //Rows that were due lost statuses: file them at their next expiry and drop them from the
+        //DoT set if their last DoT expired. Nothing else runs during a tick, so no lock.
+        {
+            ProfileProbe rescheduleProbe(ProfilePhase::TickReschedule);
+            for (const uint32_t slot : dueSlots) {
+                const uint32_t row = slotRow[slot];
+                FileSlot(*this, slot, DueTurn(*this, RowExpiry(*this, row)));
+                if (slotDotIndex[slot] != kNotDot) SetDotMember(*this, slot, RowHasDot(*this, db, row));
+            }
+        }
+        if (recording) recorder->AfterTick(*this);
+    }
+
+    std::span<const HookEntry> World::HookRules(const Db& db, uint32_t row, Hook hook, DamageType type) {
+        HookTable& table = hookTables[row];
+        if (table.builtFor != db.stamp.value) RebuildHookTable(*this, db, row, table);
+
+        const size_t b = HookTable::Bucket(hook, type);
+        return {table.entries.data() + table.offsets[b], table.entries.data() + table.offsets[b + 1]};
+    }
+
+    TagMask World::StatusTags(const Db& db, uint32_t row) {
+        HookTable& table = hookTables[row];
+        if (table.builtFor != db.stamp.value) RebuildHookTable(*this, db, row, table);
+        return table.statusTags;
+    }
+
+    WorldFork World::Fork() {
+        forkMarks.push_back((uint32_t)forkSaves.size());
+        forkEpochs.push_back(nextForkEpoch++);
+        forkStarts.push_back({stateHash.Load(), turnSteps.Load(), turn});
+        return WorldFork(*this);
+    }
+
+    void World::DiscardFork() {
+        if (!Forked()) throw std::logic_error("DiscardFork without an open fork");
+        const uint32_t mark = forkMarks.back();
+        const ForkStart start = forkStarts.back();
+        turn = start.turn;
+
+        //Latest saves first, so a row saved twice ends at its oldest state
+        for (size_t i = forkSaves.size(); i-- > mark;) {
+            const RowSave& save = forkSaves[i];
+            const uint32_t row = save.row;
+            hp[row] = save.hp;
+            armor[row] = save.armor;
+            power[row] = save.power;
+            tags[row] = save.tags;
+
+            //The hook table only depends on which statuses are present and their stacks
+            StatusRange& r = statusRange[row];
+            bool hooksChanged = r.count != save.statusCount;
+            for (uint32_t k = 0; k < save.statusCount && !hooksChanged; ++k) {
+                const StatusInstance& si = forkStatuses[save.statusBegin + k];
+                hooksChanged = statusDef[r.begin + k] != si.status || statusStacks[r.begin + k] != si.stacks;
+            }
+
+            ClearStatusSlots(*this, r.begin, r.begin + r.count);
+            r.count = 0;
+            EnsureStatusCapacity(*this, row, save.statusCount);
+            for (uint32_t k = 0; k < save.statusCount; ++k) {
+                const StatusInstance& si = forkStatuses[save.statusBegin + k];
+                const uint32_t at = statusRange[row].begin + k;
+                statusDef[at] = si.status;
+                statusStacks[at] = si.stacks;
+                statusExpiry[at] = si.remainingTurns;
+            }
+            statusRange[row].count = save.statusCount;
+            if (hooksChanged) hookTables[row].builtFor = 0;
+
+            RescheduleRow(*this, row);
+            MarkDotDirty(*this, row);
+        }
+
+        if (mark < forkSaves.size()) forkStatuses.resize(forkSaves[mark].statusBegin);
+        forkSaves.resize(mark);
+        forkMarks.pop_back();
+        forkEpochs.pop_back();
+        stateHash.Store(start.stateHash);
+        turnSteps.Store(start.turnSteps);
+        forkStarts.pop_back();
+    }
+
+    void World::MergeFork() {
+        if (!Forked()) throw std::logic_error("MergeFork without an open fork");
+        forkMarks.pop_back();
+        forkEpochs.pop_back();
+        forkStarts.pop_back();
+
+        //Inside an outer fork the saves now belong to it; at the top level nothing is left to undo
+        if (!Forked()) {
+            forkSaves.clear();
+            forkStatuses.clear();
         }
     }
 
-    bool World::EntityHasAnyStatusWithTag(const Db& db, const Entity& e, const std::string& tag) const {
+    void World::ReserveStatuses(uint32_t row, uint32_t extra) {
+        EnsureStatusCapacity(*this, row, extra);
+    }
+
+    bool World::EntityHasAnyStatusWithTag(const Db& db, ConstEntityRef e, TagMask tag) const {
+        const HookTable& table = hookTables[e.row];
+        if (table.builtFor == db.stamp.value) return (table.statusTags & tag) != 0;
+
         for(const auto& si: e.statuses) {
             if(HasStatusTag(db, si, tag)) return true;
         }
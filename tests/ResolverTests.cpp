@@ -1,8 +1,28 @@
 #include "resolver/Resolver.h"
+#include "resolver/AllocStats.h"
 #include "resolver/DbLoader.h"
+#include "resolver/DbRegistry.h"
+#include "resolver/Format.h"
+#include "resolver/Profile.h"
+#include "resolver/Replay.h"
+#include "resolver/ResolveArena.h"
+#include "resolver/Server.h"
+#include "resolver/Sim.h"
+#include "resolver/ThreadPool.h"
+#include "resolver/TraceSink.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cassert>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <type_traits>
 
 using namespace res;
 
@@ -24,12 +44,12 @@ int main()
     // Case: firebolt into burning target should include modifier and higher damage
     {
         World w;
-        w.entities[1] = Entity{1, 100, 0, 10, {"Player"}, {}};
-        w.entities[2] = Entity{2, 100, 0, 10, {"Enemy"}, {}};
+        w.Spawn(Entity{1, 100, 0, 10, db.InternTag("Player"), {}});
+        w.Spawn(Entity{2, 100, 0, 10, db.InternTag("Enemy"), {}});
 
-        w.AddStatus(db, w.entities[2], "burning", 2, 1);
+        w.AddStatus(db, w.Get(2), "burning", 2, 1);
 
-        auto trace = resolver.Resolve(w, {"firebolt", 1, {2}});
+        auto trace = resolver.Resolve(w, {db.FindAbility("firebolt"), 1, {2}});
         const std::string got = trace.ToString();
 
         const std::string expected =
@@ -52,12 +72,12 @@ int main()
     // Case: strike into shielded target should include modifier and reduced damage
     {
         World w;
-        w.entities[1] = Entity{1, 100, 0, 10, {"Player"}, {}};
-        w.entities[2] = Entity{2, 100, 0, 10, {"Enemy"}, {}};
+        w.Spawn(Entity{1, 100, 0, 10, db.InternTag("Player"), {}});
+        w.Spawn(Entity{2, 100, 0, 10, db.InternTag("Enemy"), {}});
 
-        w.AddStatus(db, w.entities[2], "shielded", 2, 1);
+        w.AddStatus(db, w.Get(2), "shielded", 2, 1);
 
-        auto trace = resolver.Resolve(w, {"strike", 1, {2}});
+        auto trace = resolver.Resolve(w, {db.FindAbility("strike"), 1, {2}});
         const std::string got = trace.ToString();
 
         const std::string expected =
@@ -76,6 +96,1215 @@ int main()
         AssertGolden("strike_vs_shielded", got, expected);
     }
 
+    // Case: burning ticks at turn start and expires once its duration runs out
+    {
+        World w;
+        w.Spawn(Entity{2, 100, 0, 10, db.InternTag("Enemy"), {}});
+
+        w.AddStatus(db, w.Get(2), "burning", 2, 2);
+
+        ResolutionTrace trace;
+        w.TickTurnStart(db, trace);
+        w.TickTurnStart(db, trace);
+        const std::string got = trace.ToString();
+
+        const std::string expected =
+            "Turn Start! \n"
+            "Entity: [2] takes [8 Fire] from burning (2 stacks).\n"
+            "Turn Start! \n"
+            "Entity: [2] takes [8 Fire] from burning (2 stacks).\n"
+            "Turn Start: Entity: 2 status expired: burning\n";
+        AssertGolden("tick_burning", got, expected);
+        assert(w.Get(2).hp == 84);
+        assert(w.Get(2).statuses.empty());
+    }
+
+    // Case: trace levels filter what is recorded without changing the outcome
+    {
+        World full, summary, off;
+        for(World* w : {&full, &summary, &off}) {
+            w->Spawn(Entity{1, 100, 0, 10, db.InternTag("Player"), {}});
+            w->Spawn(Entity{2, 100, 0, 10, db.InternTag("Enemy"), {}});
+            w->AddStatus(db, w->Get(2), "burning", 2, 1);
+        }
+
+        const ResolveRequest req{db.FindAbility("firebolt"), 1, {2}};
+        auto fullTrace = resolver.Resolve(full, req, TraceLevel::Full);
+        auto summaryTrace = resolver.Resolve(summary, req, TraceLevel::Summary);
+        auto offTrace = resolver.Resolve(off, req, TraceLevel::Off);
+
+        assert(offTrace.events.empty());
+        assert(offTrace.ToString().empty());
+        assert(summaryTrace.events.size() == fullTrace.events.size() - 1);
+        for(const auto& e : summaryTrace.events) assert(e.kind != TraceEvent::Kind::HookApplied);
+        assert(full.Get(2).hp == 79 && summary.Get(2).hp == 79 && off.Get(2).hp == 79);
+    }
+
+    // Case: batch resolution matches sequential resolution, including conflicting requests
+    {
+        auto makeWorld = [&]() {
+            World w;
+            for(EntityId id = 1; id <= 8; ++id) w.Spawn(Entity{id, 100, 0, 10, {}, {}});
+            w.AddStatus(db, w.Get(4), "shielded", 3, 1);
+            return w;
+        };
+        const AbilityHandle firebolt = db.FindAbility("firebolt");
+        const AbilityHandle strike = db.FindAbility("strike");
+        const std::vector<ResolveRequest> reqs = {
+            {firebolt, 1, {2}}, {strike, 3, {4}}, {strike, 5, {6}}, {firebolt, 7, {2}},
+            {strike, 2, {1}}, {firebolt, 8, {4}}, {strike, 6, {5}}, {firebolt, 1, {3, 4}},
+        };
+
+        World seq = makeWorld();
+        std::vector<std::string> expected;
+        for(const auto& r : reqs) expected.push_back(resolver.Resolve(seq, r).ToString());
+
+        ThreadPool pool(4);
+        Resolver batchResolver(db, &pool);
+        World par = makeWorld();
+        auto traces = batchResolver.ResolveBatch(par, reqs);
+
+        assert(traces.size() == reqs.size());
+        for(size_t i = 0; i < reqs.size(); ++i) AssertGolden("batch_" + std::to_string(i), traces[i].ToString(), expected[i]);
+        for(EntityId id = 1; id <= 8; ++id) {
+            assert(par.Get(id).hp == seq.Get(id).hp);
+            assert(par.Get(id).statuses.size() == seq.Get(id).statuses.size());
+        }
+    }
+
+    // Case: slot map keeps rows sorted by id and rejects stale handles
+    {
+        World w;
+        w.Spawn(Entity{5, 50, 0, 10, {}, {}});
+        const EntityHandle h2 = w.Spawn(Entity{2, 20, 0, 10, {}, {}});
+        w.Spawn(Entity{9, 90, 0, 10, {}, {}});
+        assert((w.ids == std::vector<EntityId>{2, 5, 9}));
+        assert(w.Get(h2).hp == 20);
+
+        w.Despawn(2);
+        assert(!w.Contains(2) && !w.IsAlive(h2));
+        bool threw = false;
+        try { w.Get(h2); } catch(const std::out_of_range&) { threw = true; }
+        assert(threw);
+
+        const EntityHandle h7 = w.Spawn(Entity{7, 70, 0, 10, {}, {}});
+        assert(h7.index == h2.index && h7.generation != h2.generation);
+        assert((w.ids == std::vector<EntityId>{5, 7, 9}));
+        assert(w.Get(9).hp == 90 && w.Get(h7).hp == 70);
+
+        //The id table grows with the entity count, not with the id values
+        const AllocStats huge = CountAllocations([&] {
+            w.Spawn(Entity{UINT32_MAX, 1, 0, 10, {}, {}});
+            w.Spawn(Entity{1u << 31, 2, 0, 10, {}, {}});
+        });
+        assert(huge.bytes < 64 * 1024);
+        assert(w.Get(UINT32_MAX).hp == 1 && w.Get(1u << 31).hp == 2 && w.ids.back() == UINT32_MAX);
+        threw = false;
+        try { w.Spawn(Entity{UINT32_MAX, 1, 0, 10, {}, {}}); } catch(const std::runtime_error&) { threw = true; }
+        assert(threw && w.Size() == 5);
+
+        //Churn through sparse ids; erasing must keep every other id reachable
+        std::vector<EntityId> live;
+        uint32_t x = 12345;
+        for(int i = 0; i < 4000; ++i) {
+            x = x * 1664525u + 1013904223u;
+            const EntityId id = (x >> 8) % 3000 * 4096;
+            if(w.Contains(id)) {
+                w.Despawn(id);
+                live.erase(std::find(live.begin(), live.end(), id));
+            } else {
+                w.Spawn(Entity{id, (int)(id % 1000), 0, 10, {}, {}});
+                live.push_back(id);
+            }
+        }
+        assert(w.Size() == live.size() + 5);
+        for(EntityId id : live) assert(w.Get(id).hp == (int)(id % 1000) && w.Get(w.HandleOf(id)).id == id);
+        for(EntityId id : {5u, 7u, 9u, UINT32_MAX, 1u << 31}) assert(w.Contains(id));
+        assert(!w.Contains(2) && !w.Contains(4096 * 3001));
+    }
+
+    // Case: the packed turn tick matches a plain per-entity tick
+    {
+        World w;
+        const StatusHandle burning = db.FindStatus("burning");
+        const StatusHandle shielded = db.FindStatus("shielded");
+        for(EntityId id = 1; id <= 40; ++id) {
+            w.Spawn(Entity{id, 100, 0, 10, {}, {}});
+            if(id % 2) w.AddStatus(db, w.Get(id), shielded, (int)(id % 4) + 1, 1);
+            w.AddStatus(db, w.Get(id), burning, (int)(id % 3) + 1, (int)(id % 5) + 1);
+        }
+        w.Despawn(7);
+        w.RemoveStatusesByTag(db, w.Get(9), "Buff", 1);
+
+        for(int turn = 0; turn < 4; ++turn) {
+            std::vector<Entity> expected;
+            for(EntityId id : w.ids) {
+                Entity e = w.Snapshot(id);
+                for(const auto& si : e.statuses) e.hp -= db.dotPerStack[si.status] * si.stacks;
+                for(auto& si : e.statuses) si.remainingTurns -= 1;
+                erase_if(e.statuses, [](const StatusInstance& si) { return si.remainingTurns <= 0; });
+                expected.push_back(std::move(e));
+            }
+
+            ResolutionTrace trace;
+            trace.level = TraceLevel::Off;
+            w.TickTurnStart(db, trace);
+            assert(trace.events.empty());
+
+            for(const auto& e : expected) {
+                const Entity got = w.Snapshot(e.id);
+                assert(got.hp == e.hp);
+                assert(got.statuses.size() == e.statuses.size());
+                for(size_t i = 0; i < e.statuses.size(); ++i) {
+                    assert(got.statuses[i].status == e.statuses[i].status);
+                    assert(got.statuses[i].stacks == e.statuses[i].stacks);
+                    assert(got.statuses[i].remainingTurns == e.statuses[i].remainingTurns);
+                }
+            }
+        }
+    }
+
+    // Case: cached hook tables follow stack changes and status removal
+    {
+        World w;
+        w.Spawn(Entity{1, 100, 0, 10, db.InternTag("Player"), {}});
+        w.Spawn(Entity{2, 200, 0, 10, db.InternTag("Enemy"), {}});
+        const ResolveRequest firebolt{db.FindAbility("firebolt"), 1, {2}};
+
+        resolver.Resolve(w, firebolt, TraceLevel::Off);     // 18, applies burning x1
+        assert(w.Get(2).hp == 182);
+        resolver.Resolve(w, firebolt, TraceLevel::Off);     // 18 * 1.2, burning x2
+        assert(w.Get(2).hp == 161);
+        resolver.Resolve(w, firebolt, TraceLevel::Off);     // 18 * 1.2^2
+        assert(w.Get(2).hp == 136);
+
+        w.RemoveStatusesByTag(db, w.Get(2), "Fire", 1);
+        resolver.Resolve(w, firebolt, TraceLevel::Off);     // no burning when the hit lands
+        assert(w.Get(2).hp == 118);
+    }
+
+    // Case: tag conditions on hook rules match through the interned tag masks
+    {
+        Db tagged = db;
+        StatusDef focus;
+        focus.id = "focus";
+        ModifierRule rule;
+        rule.when.abilityHasTag = "Spell";
+        rule.when.targetHasStatusTag = "Fire";
+        rule.modify = {0.f, 2.f};
+        focus.hooks[Hook::OnBeforeDealDamage].push_back(rule);
+        const StatusHandle focusHandle = tagged.AddStatus(focus);
+        assert(tagged.GetStatus(focusHandle).hooks.at(Hook::OnBeforeDealDamage)[0].when.targetStatusTagMask == tagged.TagMaskOf("Fire"));
+        assert(tagged.TagMaskOf("NoSuchTag") == 0);
+
+        Resolver tagResolver(tagged);
+        World w;
+        w.Spawn(Entity{1, 100, 0, 10, {}, {}});
+        w.Spawn(Entity{2, 100, 0, 10, {}, {}});
+        w.AddStatus(tagged, w.Get(1), focusHandle, 5, 1);
+
+        tagResolver.Resolve(w, {tagged.FindAbility("strike"), 1, {2}}, TraceLevel::Off);    // not a spell
+        assert(w.Get(2).hp == 85);
+        tagResolver.Resolve(w, {tagged.FindAbility("firebolt"), 1, {2}}, TraceLevel::Off);  // target not burning yet
+        assert(w.Get(2).hp == 67);
+        tagResolver.Resolve(w, {tagged.FindAbility("firebolt"), 1, {2}}, TraceLevel::Off);  // 18 * 2 * 1.2
+        assert(w.Get(2).hp == 24);
+        assert(w.EntityHasAnyStatusWithTag(tagged, w.Get(2), tagged.TagMaskOf("DoT")));
+        assert(w.RemoveStatusesByTag(tagged, w.Get(2), "Debuff", 1) == 1);
+        assert(w.StatusTags(tagged, w.Get(2).row) == 0);
+    }
+
+    // Case: a packed snapshot loads back into an equivalent Db and rejects corruption
+    {
+        const std::string path = "resolver_tests_snapshot.resdb";
+        DbLoader::WriteSnapshot(db, path);
+        const Db packed = DbLoader::LoadFromSnapshot(path);
+
+        assert(packed.tagNames == db.tagNames);
+        assert(packed.abilities.size() == db.abilities.size() && packed.statuses.size() == db.statuses.size());
+        for(size_t i = 0; i < db.abilities.size(); ++i) {
+            assert(packed.abilities[i].id == db.abilities[i].id);
+            assert(packed.abilities[i].tagMask == db.abilities[i].tagMask);
+        }
+        assert(packed.dotPerStack == db.dotPerStack);
+
+        for(const char* ability : {"firebolt", "strike"}) {
+            World a, b;
+            for(World* w : {&a, &b}) {
+                w->Spawn(Entity{1, 100, 0, 10, {}, {}});
+                w->Spawn(Entity{2, 100, 0, 10, {}, {}});
+            }
+            a.AddStatus(db, a.Get(2), "burning", 2, 1);
+            a.AddStatus(db, a.Get(2), "shielded", 2, 1);
+            b.AddStatus(packed, b.Get(2), "burning", 2, 1);
+            b.AddStatus(packed, b.Get(2), "shielded", 2, 1);
+            const auto expected = resolver.Resolve(a, {db.FindAbility(ability), 1, {2}}).ToString();
+            const auto got = Resolver(packed).Resolve(b, {packed.FindAbility(ability), 1, {2}}).ToString();
+            AssertGolden(std::string("snapshot_") + ability, got, expected);
+        }
+
+        {
+            std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+            f.seekp(-1, std::ios::end);
+            f.put('\x7f');
+        }
+        bool threw = false;
+        try { DbLoader::LoadFromSnapshot(path); } catch(const std::runtime_error&) { threw = true; }
+        assert(threw);
+        std::remove(path.c_str());
+    }
+
+    // Case: a directory of shards loads concurrently and resolves references across shards
+    {
+        namespace fs = std::filesystem;
+        const fs::path dir = "resolver_tests_shards";
+        fs::remove_all(dir);
+        fs::create_directory(dir);
+        //Abilities sort first, so their ApplyStatus references are only satisfiable after every shard is in
+        fs::copy_file("data/abilities.json", dir / "00_abilities.json");
+        fs::copy_file("data/statuses.json", dir / "10_statuses.json");
+        std::ofstream(dir / "20_extra.json") <<
+            R"({"statuses": [{"id": "chilled", "tags": ["Debuff", "Ice"], "dot": {"damageType": "Ice", "perStackBase": 1}}],)"
+            R"( "abilities": [{"id": "ignite", "targeting": {"mode": "SingleEnemy"},)"
+            R"( "effects": [{"type": "ApplyStatus", "statusId": "burning", "duration": 3}]}]})";
+
+        ThreadPool pool(4);
+        const Db sharded = DbLoader::LoadFromDirectory(dir.string(), &pool);
+        assert(sharded.statuses.size() == 3 && sharded.abilities.size() == 3);
+        assert(sharded.FindStatus("burning") == db.FindStatus("burning"));
+        assert(sharded.FindAbility("firebolt") == db.FindAbility("firebolt"));
+        assert(sharded.GetAbility(sharded.FindAbility("ignite")).effects[0].status == sharded.FindStatus("burning"));
+        assert(sharded.GetStatus(sharded.FindStatus("burning")).hooks.at(Hook::OnBeforeTakeDamage).size() == 1);
+
+        const Db pooled = DbLoader::LoadFromFiles("data/abilities.json", "data/statuses.json", &pool);
+        //db has since interned entity tags too; content tags come first
+        assert(std::equal(pooled.tagNames.begin(), pooled.tagNames.end(), db.tagNames.begin()));
+        assert(pooled.dotPerStack == db.dotPerStack);
+
+        std::ofstream(dir / "30_bad.json") <<
+            R"({"abilities": [{"id": "frostbite", "targeting": {"mode": "SingleEnemy"},)"
+            R"( "effects": [{"type": "ApplyStatus", "statusId": "frozen", "duration": 1}]}]})";
+        bool threw = false;
+        try { DbLoader::LoadFromDirectory(dir.string(), &pool); } catch(const std::runtime_error&) { threw = true; }
+        assert(threw);
+        fs::remove_all(dir);
+    }
+
+    // Case: hot reload publishes a new Db while pinned snapshots and traces keep the old one
+    {
+        DbRegistry registry(DbLoader::LoadFromFiles("data/abilities.json", "data/statuses.json"));
+        Resolver hot(registry);
+        const ResolveRequest req{db.FindAbility("firebolt"), 1, {2}};
+
+        World w;
+        w.Spawn(Entity{1, 100, 0, 10, {}, {}});
+        w.Spawn(Entity{2, 200, 0, 10, {}, {}});
+        auto before = hot.Resolve(w, req);
+        assert(w.Get(2).hp == 182);
+
+        const auto pinned = registry.Acquire();
+        Db buffed = *pinned;
+        AbilityDef firebolt = buffed.GetAbility(req.ability);
+        firebolt.effects[0].amount.base = 22.f;
+        buffed.ReplaceAbility(req.ability, std::move(firebolt));
+        assert(registry.Publish(std::move(buffed)) == pinned.version + 1);
+
+        hot.Resolve(w, req, TraceLevel::Off);      // (22 + 6) * 1.2 against the new content
+        assert(w.Get(2).hp == 149);
+        assert(pinned->GetAbility(req.ability).effects[0].amount.base == 12.f);
+        assert(before.ToString().find("Amount:[18 Fire]") != std::string::npos);
+
+        //Readers racing publishers only ever see versions move forward
+        std::atomic<bool> done{false};
+        std::vector<std::thread> readers;
+        for(int t = 0; t < 3; ++t) {
+            readers.emplace_back([&] {
+                uint64_t last = 0;
+                while(!done.load()) {
+                    const auto s = registry.Acquire();
+                    assert(s.version >= last && s->abilities.size() == 2);
+                    last = s.version;
+                }
+            });
+        }
+        for(int i = 0; i < 50; ++i) registry.Publish(Db(*registry.Acquire()));
+        done = true;
+        for(auto& t : readers) t.join();
+        assert(registry.Version() == pinned.version + 51);
+
+        //Live worlds hold handles, so content that reorders or drops defs is refused
+        auto refused = [&](Db next) {
+            try { registry.Publish(std::move(next)); } catch(const std::runtime_error&) { return true; }
+            return false;
+        };
+        Db reordered;
+        for(size_t i = pinned->statuses.size(); i-- > 0;) reordered.AddStatus(pinned->statuses[i]);
+        for(size_t i = pinned->abilities.size(); i-- > 0;) reordered.AddAbility(pinned->abilities[i]);
+        assert(reordered.FindStatus("burning") != pinned->FindStatus("burning"));
+        assert(refused(std::move(reordered)));
+        Db statusesOnly;
+        for(const auto& s : pinned->statuses) statusesOnly.AddStatus(s);
+        assert(refused(std::move(statusesOnly)));
+        assert(registry.Version() == pinned.version + 51);
+
+        //Appending keeps every old handle, so it is accepted and old handles still resolve
+        Db extended = *registry.Acquire();
+        AbilityDef echo = extended.GetAbility(req.ability);
+        echo.id = "echo";
+        const AbilityHandle echoHandle = extended.AddAbility(std::move(echo));
+        registry.Publish(std::move(extended));
+        assert(echoHandle == pinned->abilities.size());
+        hot.Resolve(w, {echoHandle, 1, {2}}, TraceLevel::Off);
+        assert(w.Get(2).hp == 109);     // burning stacks from earlier casts amplify each hit
+        hot.Resolve(w, req, TraceLevel::Off);
+        assert(w.Get(2).hp == 61);
+    }
+
+    // Case: steady-state resolves and turn ticks do not allocate once storage is warm
+    {
+        assert(AllocationCountingEnabled());
+        assert(CountAllocations([&] { World tmp; tmp.Spawn(Entity{1, 100, 0, 10, {}, {}}); }).allocations > 0);
+
+        World w;
+        w.Spawn(Entity{1, 1'000'000, 0, 10, {}, {}});
+        w.Spawn(Entity{2, 1'000'000, 0, 10, {}, {}});
+        w.ReserveStatuses(w.RowOf(1), 4);
+        w.ReserveStatuses(w.RowOf(2), 4);
+        const ResolveRequest firebolt{db.FindAbility("firebolt"), 1, {2}};
+        const ResolveRequest strike{db.FindAbility("strike"), 2, {1}};
+        const StatusHandle shielded = db.FindStatus("shielded");
+
+        for(TraceLevel level : {TraceLevel::Off, TraceLevel::Summary}) {
+            ResolutionTrace trace;
+            trace.level = level;
+            auto round = [&] {
+                trace.Clear();
+                resolver.Resolve(w, firebolt, trace);
+                resolver.Resolve(w, strike, trace);
+                w.AddStatus(db, w.Get(1), shielded, 1, 1);
+                w.TickTurnStart(db, trace);
+            };
+            for(int i = 0; i < 3; ++i) round();
+
+            ThreadAllocProfile() = {};
+            const AllocStats steady = CountAllocations([&] { for(int i = 0; i < 100; ++i) round(); });
+            if(steady.allocations != 0) {
+                std::cerr << "steady state allocated " << steady.allocations << " times (" << steady.bytes
+                          << " bytes) at trace level " << (int)level << "\n";
+                assert(false);
+            }
+            const AllocProfile& profile = ThreadAllocProfile();
+            assert(profile.resolve.calls == 200 && profile.resolve.total.allocations == 0);
+            assert(profile.tick.calls == 100 && profile.tick.total.allocations == 0);
+        }
+    }
+
+    // Case: traces and rendered text built on a ResolveArena stay off the global heap
+    {
+        World w;
+        w.Spawn(Entity{1, 1'000'000, 0, 10, {}, {}});
+        w.Spawn(Entity{2, 1'000'000, 0, 10, {}, {}});
+        w.ReserveStatuses(w.RowOf(2), 4);
+        const ResolveRequest firebolt{db.FindAbility("firebolt"), 1, {2}};
+
+        ResolveArena arena(256);
+        std::string expected;
+        auto cycle = [&] {
+            arena.Reset();
+            auto trace = resolver.Resolve(w, firebolt, TraceLevel::Full, arena.Resource());
+            const auto text = trace.ToString(arena.Resource());
+            expected.assign(text.data(), text.size());
+        };
+        for(int i = 0; i < 3; ++i) cycle();     // the first cycles spill and grow the arena
+        assert(arena.Capacity() > 256);
+        assert(expected.find("Resolving hooks:") != std::string::npos);
+
+        const AllocStats steady = CountAllocations([&] { for(int i = 0; i < 50; ++i) cycle(); });
+        assert(steady.allocations == 0);
+
+        auto plain = resolver.Resolve(w, firebolt);
+        assert(plain.ToString() == std::string(plain.ToString(arena.Resource())));
+
+        //Batch scheduling buffers can come from the arena too
+        arena.Reset();
+        const std::vector<ResolveRequest> reqs = {firebolt, {db.FindAbility("strike"), 2, {1}}};
+        auto traces = resolver.ResolveBatch(w, reqs, TraceLevel::Summary, arena.Resource());
+        assert(traces.size() == 2 && !traces[1].events.empty());
+    }
+
+    // Case: forks restore exactly what they touched when discarded and keep it when merged
+    {
+        auto same = [](const World& a, const World& b) {
+            for(EntityId id : a.ids) {
+                const Entity x = a.Snapshot(id), y = b.Snapshot(id);
+                if(x.hp != y.hp || x.armor != y.armor || x.tags != y.tags || x.statuses.size() != y.statuses.size()) return false;
+                for(size_t i = 0; i < x.statuses.size(); ++i) {
+                    if(x.statuses[i].status != y.statuses[i].status || x.statuses[i].stacks != y.statuses[i].stacks ||
+                       x.statuses[i].remainingTurns != y.statuses[i].remainingTurns) return false;
+                }
+            }
+            return a.ids == b.ids;
+        };
+
+        World w;
+        for(EntityId id = 1; id <= 6; ++id) w.Spawn(Entity{id, 100, 0, 10, {}, {}});
+        w.AddStatus(db, w.Get(3), "shielded", 3, 1);
+        const World original = w;
+        const ResolveRequest firebolt{db.FindAbility("firebolt"), 1, {2}};
+        const ResolveRequest strike{db.FindAbility("strike"), 2, {3}};
+
+        {
+            auto fork = w.Fork();
+            resolver.Resolve(*fork, firebolt, TraceLevel::Off);
+            {
+                auto inner = w.Fork();
+                resolver.Resolve(w, strike, TraceLevel::Off);
+                ResolutionTrace tick;
+                w.TickTurnStart(db, tick);
+                assert(!same(w, original));
+            }   // inner discarded on scope exit
+            w.RemoveStatusesByTag(db, w.Get(3), "Buff", 1);
+            assert(w.forkSaves.size() == 3);    // rows 1, 2 and 3, once each
+            fork.Discard();
+        }
+        assert(!w.Forked() && same(w, original));
+        assert(w.forkSaves.empty() && w.forkStatuses.empty());
+
+        //A merged inner fork is still undone by discarding the outer one
+        {
+            auto outer = w.Fork();
+            auto inner = w.Fork();
+            resolver.Resolve(w, firebolt, TraceLevel::Off);
+            inner.Merge();
+            resolver.Resolve(w, strike, TraceLevel::Off);
+        }
+        assert(same(w, original));
+
+        World seq = original;
+        resolver.Resolve(seq, firebolt, TraceLevel::Off);
+        resolver.Resolve(seq, strike, TraceLevel::Off);
+        {
+            auto fork = w.Fork();
+            resolver.Resolve(w, firebolt, TraceLevel::Off);
+            resolver.Resolve(w, strike, TraceLevel::Off);
+            bool threw = false;
+            try { w.Spawn(Entity{9, 100, 0, 10, {}, {}}); } catch(const std::logic_error&) { threw = true; }
+            assert(threw);
+            fork.Merge();
+        }
+        assert(same(w, seq) && w.forkSaves.empty());
+    }
+
+    // Case: a recorded session replays to the same state and a diverging one is caught
+    {
+        namespace fs = std::filesystem;
+        const std::string log = (fs::temp_directory_path() / "resolver_tests_replay.log").string();
+
+        World w;
+        for(EntityId id = 1; id <= 4; ++id) w.Spawn(Entity{id, 100, 0, 10, {}, {}});
+        w.AddStatus(db, w.Get(4), "shielded", 3, 1);
+        const ResolveRequest firebolt{db.FindAbility("firebolt"), 1, {2}};
+        const ResolveRequest strike{db.FindAbility("strike"), 2, {4}};
+        {
+            ReplayRecorder recorder(log, w);
+            w.recorder = &recorder;
+            resolver.Resolve(w, firebolt, TraceLevel::Off);
+            {
+                //Speculative work stays out of the log
+                auto fork = w.Fork();
+                resolver.Resolve(w, strike, TraceLevel::Off);
+            }
+            ResolutionTrace tick;
+            w.TickTurnStart(db, tick);
+            const ResolveRequest batch[] = {strike, firebolt, {db.FindAbility("strike"), 3, {1}}};
+            resolver.ResolveBatch(w, batch, TraceLevel::Off);
+            w.TickTurnStart(db, tick);
+            assert(recorder.Operations() == 6);
+
+            const World copy = w;
+            assert(!copy.recorder);
+            w.recorder = nullptr;
+        }
+
+        ReplayReport report = Replay(db, log);
+        assert(report.operations == 6 && report.resolves == 4 && report.ticks == 2);
+        assert(report.checkpoints == 2 && report.mismatches == 0 && report.failedResolves == 0);
+        assert(report.dbVersions == std::vector<uint64_t>{0});   // unversioned Db
+        assert(ReplayStateHash(report.world) == ReplayStateHash(w));
+
+        //A log naming huge entity ids reads back without sizing anything by them
+        {
+            World sparse;
+            sparse.Spawn(Entity{UINT32_MAX, 100, 0, 10, {}, {}});
+            sparse.Spawn(Entity{1u << 30, 100, 0, 10, {}, {}});
+            const std::string sparseLog = (fs::temp_directory_path() / "resolver_tests_sparse.log").string();
+            { ReplayRecorder recorder(sparseLog, sparse); }
+            ReplayReport read;
+            const AllocStats used = CountAllocations([&] { read = Replay(db, sparseLog); });
+            fs::remove(sparseLog);
+            assert(used.bytes < 1024 * 1024);
+            assert(read.world.Size() == 2 && read.world.Contains(UINT32_MAX));
+            assert(ReplayStateHash(read.world) == ReplayStateHash(sparse));
+        }
+
+        //Only the requested window is traced
+        std::ostringstream traced;
+        ReplayOptions opts;
+        opts.traceFrom = 3;
+        opts.traceTo = 4;
+        opts.traceOut = &traced;
+        Replay(db, log, opts);
+        assert(traced.str().find("=== op 3 ===") == 0 && traced.str().find("Resolving ability: [firebolt]") != std::string::npos);
+        assert(traced.str().find("=== op 2 ===") == std::string::npos);
+
+        //Replaying against different content diverges at the first checkpoint
+        Db changed = db;
+        AbilityDef stronger = changed.GetAbility(firebolt.ability);
+        stronger.effects[0].amount.base += 5;
+        changed.ReplaceAbility(firebolt.ability, std::move(stronger));
+        report = Replay(changed, log);
+        assert(report.mismatches == 1 && report.firstMismatchOp == 2);
+
+        std::ofstream(log, std::ios::binary | std::ios::app).put((char)ReplayEntry::Resolve);
+        bool threw = false;
+        try { Replay(db, log); } catch(const std::runtime_error&) { threw = true; }
+        assert(threw);
+        fs::remove(log);
+    }
+
+    // Case: the incremental state hash tracks every mutation and matches a full rehash
+    {
+        World w;
+        for(EntityId id = 1; id <= 8; ++id) w.Spawn(Entity{id, 100, id % 3 == 0 ? 2 : 0, 10, {}, {{db.FindStatus("burning"), 1, 2}}});
+        w.AddStatus(db, w.Get(4), "shielded", 3, 1);
+        auto consistent = [](World& x) { const uint64_t h = x.StateHash(); return x.RehashState() == h; };
+        assert(consistent(w));
+
+        ThreadPool pool(4);
+        const Resolver parallel(db, &pool);
+        std::vector<ResolveRequest> reqs;
+        for(EntityId id = 1; id <= 8; ++id) reqs.push_back({db.FindAbility(id % 2 ? "firebolt" : "strike"), id, {id % 8 + 1}});
+        parallel.ResolveBatch(w, reqs, TraceLevel::Off);
+        assert(consistent(w));
+
+        const uint64_t beforeTick = w.StateHash();
+        ResolutionTrace tick;
+        for(int t = 0; t < 4; ++t) {
+            w.TickTurnStart(db, tick);
+            assert(consistent(w));
+        }
+        assert(w.StateHash() != beforeTick);
+        w.RemoveStatusesByTag(db, w.Get(4), "Buff", 1);
+        assert(consistent(w));
+
+        {
+            auto fork = w.Fork();
+            const uint64_t h = w.StateHash();
+            resolver.Resolve(w, reqs[0], TraceLevel::Off);
+            assert(consistent(w) && w.StateHash() != h);
+        }
+        assert(consistent(w));
+
+        //Equal states hash equal however they were reached
+        World a, b;
+        a.Spawn(Entity{1, 100, 0, 10, {}, {}});
+        a.Spawn(Entity{2, 100, 0, 10, {}, {}});
+        b.Spawn(Entity{2, 90, 0, 10, {}, {}});
+        b.Spawn(Entity{1, 100, 0, 10, {}, {}});
+        assert(a.StateHash() != b.StateHash());
+        b.SetStat(b.Get(2), Stat::HP, 100);
+        assert(a.StateHash() == b.StateHash());
+        a.Despawn(2);
+        assert(consistent(a) && a.StateHash() != b.StateHash());
+    }
+
+    // Case: a parallel turn tick matches the serial one, trace included
+    {
+        const StatusHandle burning = db.FindStatus("burning"), shielded = db.FindStatus("shielded");
+        World serial;
+        for(EntityId id = 1; id <= 3000; ++id) {
+            Entity e{id, 1000, 0, 10, {}, {}};
+            if(id % 3 != 0) e.statuses.push_back({burning, 1 + (int)(id % 2), 1 + (int)(id % 4)});
+            if(id % 5 == 0) e.statuses.push_back({shielded, 1, 1 + (int)(id % 3)});
+            serial.Spawn(std::move(e));
+        }
+        World parallel = serial;
+
+        ThreadPool pool(4);
+        for(int t = 0; t < 4; ++t) {
+            ResolutionTrace a, b;
+            serial.TickTurnStart(db, a);
+            parallel.TickTurnStart(db, b, &pool);
+            assert(!a.events.empty());
+            AssertGolden("parallel_tick", b.ToString(), a.ToString());
+        }
+        assert(parallel.hp == serial.hp && parallel.StateHash() == serial.StateHash());
+        assert(parallel.RehashState() == serial.StateHash());
+    }
+
+    // Case: area abilities hit every target in one pass and match resolving each target alone
+    {
+        namespace fs = std::filesystem;
+        const fs::path dir = "resolver_tests_area";
+        fs::remove_all(dir);
+        fs::create_directory(dir);
+        fs::copy_file("data/statuses.json", dir / "00_statuses.json");
+        std::ofstream(dir / "10_area.json") <<
+            R"({"statuses": [{"id": "enraged", "tags": ["Buff"], "hooks": {"OnBeforeDealDamage": [)"
+            R"(  {"modify": {"multiplier": 1.5}}, {"when": {"targetHasStatusTag": "Buff"}, "modify": {"addFlat": 3}}]}}],)"
+            R"( "abilities": [)"
+            R"(  {"id": "cleave", "targeting": {"mode": "AllEnemies"}, "effects": [)"
+            R"(    {"type": "Damage", "damageType": "Physical", "amount": {"base": 10, "scalesWith": "Power", "scale": 0.5}},)"
+            R"(    {"type": "ApplyStatus", "statusId": "burning", "duration": 2}]},)"
+            R"(  {"id": "cleave_one", "targeting": {"mode": "SingleEnemy"}, "effects": [)"
+            R"(    {"type": "Damage", "damageType": "Physical", "amount": {"base": 10, "scalesWith": "Power", "scale": 0.5}},)"
+            R"(    {"type": "ApplyStatus", "statusId": "burning", "duration": 2}]},)"
+            R"(  {"id": "volley", "targeting": {"mode": "Group", "maxTargets": 2}, "effects": [)"
+            R"(    {"type": "Damage", "damageType": "Fire", "amount": {"base": 5, "scalesWith": "Power", "scale": 0}}]}]})";
+        const Db area = DbLoader::LoadFromDirectory(dir.string());
+        fs::remove_all(dir);
+        const Resolver areaResolver(area);
+
+        auto spawn = [&](World& w) {
+            for(EntityId id = 1; id <= 6; ++id) w.Spawn(Entity{id, 100, 0, 10, {}, {}});
+            w.AddStatus(area, w.Get(1), "enraged", 5, 1);
+            w.AddStatus(area, w.Get(3), "shielded", 5, 1);
+            w.AddStatus(area, w.Get(4), "burning", 5, 1);
+        };
+        World batched, separate;
+        spawn(batched);
+        spawn(separate);
+
+        const auto trace = areaResolver.Resolve(batched, {area.FindAbility("cleave"), 1, {2, 3, 4, 5, 6}});
+        for(EntityId t = 2; t <= 6; ++t) areaResolver.Resolve(separate, {area.FindAbility("cleave_one"), 1, {t}}, TraceLevel::Off);
+        assert(batched.hp == separate.hp && batched.StateHash() == separate.StateHash());
+        //15 * 1.5 = 22 for a plain target; (15 * 1.5 + 3) * 0.8 = 20 into the shield
+        assert(batched.Get(2).hp == 78 && batched.Get(3).hp == 80);
+
+        //The caster's unconditional rule is traced once; the target dependent one only for the shielded target
+        const std::string text = trace.ToString();
+        auto count = [&](const std::string& needle) {
+            size_t n = 0;
+            for(size_t at = text.find(needle); at != std::string::npos; at = text.find(needle, at + 1)) ++n;
+            return n;
+        };
+        assert(count("Resolving ability:") == 1 && count("Resolving Damage:") == 5 && count("Status applied:") == 5);
+        assert(count("Current Status:[enraged]") == 2);
+
+        const AbilityHandle volley = area.FindAbility("volley");
+        const auto tooMany = areaResolver.Resolve(batched, {volley, 1, {2, 3, 4}});
+        assert(tooMany.ToString().find("Error: Group ability needs between one and maxTargets targets") != std::string::npos);
+        const auto self = areaResolver.Resolve(batched, {area.FindAbility("cleave"), 1, {1, 2}});
+        assert(self.ToString().find("Error: AllEnemies ability") != std::string::npos);
+        assert(batched.hp == separate.hp);
+
+        const std::string path = "resolver_tests_area.resdb";
+        DbLoader::WriteSnapshot(area, path);
+        const Db packed = DbLoader::LoadFromSnapshot(path);
+        std::remove(path.c_str());
+        assert(packed.GetAbility(volley).targeting.mode == TargetMode::Group && packed.GetAbility(volley).targeting.maxTargets == 2);
+    }
+
+    // Case: expiries come off the timing wheel; refreshes reschedule, removals cancel, idle rows are skipped
+    {
+        const StatusHandle burning = db.FindStatus("burning"), shielded = db.FindStatus("shielded");
+        World w;
+        for(EntityId id = 1; id <= 100; ++id) w.Spawn(Entity{id, 100, 0, 10, {}, {}});
+        w.AddStatus(db, w.Get(1), shielded, 2, 1);
+        w.AddStatus(db, w.Get(2), shielded, 2, 1);
+        w.AddStatus(db, w.Get(3), shielded, 5000, 1);       // beyond the mid level
+        w.AddStatus(db, w.Get(4), burning, 3, 1);
+        assert(w.expiryWheel.Size() == 4);
+        w.AddStatus(db, w.Get(1), shielded, 6, 1);
+        w.RemoveStatusesByTag(db, w.Get(2), "Buff", 1);
+        assert(w.expiryWheel.Size() == 3);
+
+        ResolutionTrace trace;
+        {
+            auto fork = w.Fork();
+            for(int t = 0; t < 3; ++t) w.TickTurnStart(db, trace);
+            assert(w.forkSaves.size() == 1 && w.Snapshot(4).statuses.empty());
+        }
+        assert(w.turn == 0 && w.Snapshot(4).statuses.size() == 1 && w.Snapshot(4).statuses[0].remainingTurns == 3);
+
+        std::vector<std::pair<int, EntityId>> expired;
+        for(int t = 1; t <= 5000; ++t) {
+            trace.Clear();
+            w.TickTurnStart(db, trace);
+            for(const auto& e : trace.events) {
+                if(e.kind == TraceEvent::Kind::StatusExpired) expired.push_back({t, e.expired.entity});
+            }
+            if(t == 10) assert(w.Snapshot(3).statuses[0].remainingTurns == 4990);
+        }
+        assert((expired == std::vector<std::pair<int, EntityId>>{{3, 4}, {6, 1}, {5000, 3}}));
+        assert(w.expiryWheel.Size() == 0 && w.Get(4).hp == 88);
+        const uint64_t h = w.StateHash();
+        assert(w.RehashState() == h);
+    }
+
+    // Case: small vectors keep common sizes inline and behave like vectors once they spill
+    {
+        const StatusHandle burning = db.FindStatus("burning"), shielded = db.FindStatus("shielded");
+        const Entity typical{1, 100, 0, 10, {}, {{burning, 2, 3}, {shielded, 1, 2}}};
+        World w;
+        w.Spawn(typical);
+        assert(CountAllocations([&] {
+            Entity copy = typical;
+            Entity moved = std::move(copy);
+            const Entity snap = w.Snapshot(1);
+            assert(moved.statuses.size() == 2 && moved.statuses[1].status == shielded && snap.statuses[0].remainingTurns == 3);
+        }).allocations == 0);
+        assert(CountAllocations([&] { const AbilityDef copy = db.GetAbility(db.FindAbility("firebolt")); }).allocations == 0);
+
+        SmallVector<std::string, 2> v{"a", "b"};
+        assert(v.IsInline());
+        v.push_back(v[0]);                  // grows while reading from the old block
+        v.push_back("d");
+        assert(!v.IsInline() && v.size() == 4 && v[2] == "a" && v.back() == "d");
+        SmallVector<std::string, 2> stolen = std::move(v);
+        assert(v.empty() && v.IsInline() && stolen.size() == 4 && !stolen.IsInline());
+        stolen.erase(stolen.begin() + 1);
+        assert(erase_if(stolen, [](const std::string& s) { return s == "d"; }) == 1);
+        assert((stolen == SmallVector<std::string, 2>{"a", "a"}));
+        v = stolen;
+        stolen.resize(1);
+        assert(v.size() == 2 && stolen.size() == 1 && stolen[0] == "a");
+    }
+
+    // Case: resolver_server answers pipelined requests per encounter in arrival order and matches local worlds
+    {
+        const std::string socket = "resolver_tests.sock";
+        ResolverServer server(db, {socket, 2});
+        std::thread loop([&] { server.Run(); });
+
+        const TagMask player = db.InternTag("Player"), enemy = db.InternTag("Enemy");
+        const Entity hero{1, 100, 0, 10, player, {}};
+        const Entity foe{2, 100, 0, 10, enemy, {{db.FindStatus("burning"), 1, 3}}};
+        World local[2];
+        uint64_t expectedHash[2] = {};
+
+        //Both encounters interleaved in one pipeline; the server splits them across its workers
+        std::vector<WireMessage> sent;
+        auto send = [&](WireKind kind, uint32_t encounter) -> WireMessage& {
+            WireMessage& m = sent.emplace_back();
+            m.kind = kind;
+            m.tag = sent.size() - 1;
+            m.encounter = encounter;
+            return m;
+        };
+        for(uint32_t e = 0; e < 2; ++e) {
+            send(WireKind::Spawn, e).entity = hero;
+            send(WireKind::Spawn, e).entity = foe;
+            local[e].Spawn(hero);
+            local[e].Spawn(foe);
+        }
+        for(int round = 0; round < 6; ++round) {
+            for(uint32_t e = 0; e < 2; ++e) {
+                const ResolveRequest req{db.FindAbility(round % 2 ? "strike" : "firebolt"), 1, {2}};
+                send(WireKind::Resolve, e).request = req;
+                resolver.Resolve(local[e], req, TraceLevel::Off);
+                if((uint32_t)round % 3 == e) {
+                    send(WireKind::Tick, e).wantTrace = true;
+                    ResolutionTrace unused;
+                    local[e].TickTurnStart(db, unused);
+                }
+                expectedHash[e] = local[e].StateHash();
+            }
+        }
+        ResolutionTrace expectedTrace = resolver.Resolve(local[1], {db.FindAbility("firebolt"), 2, {1}});
+        WireMessage& traced = send(WireKind::Resolve, 1);
+        traced.request = {db.FindAbility("firebolt"), 2, {1}};
+        traced.wantTrace = true;
+        send(WireKind::Resolve, 0).request = {db.FindAbility("firebolt"), 1, {1, 2}};   // two targets for a single-target ability
+        send(WireKind::Resolve, 0).request = {db.FindAbility("firebolt"), 1, {9}};
+        send(WireKind::Tick, 7);
+        send(WireKind::Reply, 0);
+
+        ResolverClient client(socket);
+        for(const auto& m : sent) client.Send(m);
+        std::vector<WireMessage> replies(sent.size());
+        uint64_t lastHash[2] = {};
+        std::vector<uint64_t> order[2];
+        for(size_t i = 0; i < sent.size(); ++i) {
+            WireMessage r = client.Receive();
+            assert(r.kind == WireKind::Reply && r.tag < sent.size() && r.encounter == sent[r.tag].encounter);
+            if(r.encounter < 2) {
+                order[r.encounter].push_back(r.tag);
+                if(r.ok) lastHash[r.encounter] = r.stateHash;
+            }
+            replies[r.tag] = std::move(r);
+        }
+        for(const auto& o : order) assert(std::is_sorted(o.begin(), o.end()));
+        assert(lastHash[0] == expectedHash[0] && lastHash[1] == local[1].StateHash());
+
+        const size_t tail = sent.size() - 5;
+        assert(replies[tail].ok && replies[tail].text == expectedTrace.ToString());
+        assert(!replies[tail + 1].ok && replies[tail + 1].text == "Invalid targets");
+        assert(!replies[tail + 2].ok && replies[tail + 2].text == "Unknown entity: 9");
+        assert(!replies[tail + 3].ok && replies[tail + 3].text == "Unknown encounter: 7");
+        assert(!replies[tail + 4].ok);
+        assert(std::all_of(replies.begin(), replies.begin() + tail, [](const WireMessage& r) { return r.ok; }));
+        const auto tickWithTrace = std::find_if(sent.begin(), sent.end(), [](const WireMessage& m) { return m.kind == WireKind::Tick; });
+        assert(replies[tickWithTrace - sent.begin()].text.find("burning") != std::string::npos);
+
+        //Frames survive arbitrary splits, and a corrupt one is rejected rather than misread
+        std::string bytes;
+        EncodeFrame(sent[1], bytes);
+        WireMessage decoded;
+        for(size_t cut = 0; cut < bytes.size(); ++cut) assert(DecodeFrame(bytes.data(), cut, decoded) == 0);
+        assert(DecodeFrame(bytes.data(), bytes.size(), decoded) == bytes.size());
+        assert(decoded.kind == WireKind::Spawn && decoded.entity.statuses.size() == 1 && decoded.entity.statuses[0].remainingTurns == 3);
+        bytes[kWireHeaderBytes] = 42;
+        bool threw = false;
+        try { DecodeFrame(bytes.data(), bytes.size(), decoded); } catch(const std::runtime_error&) { threw = true; }
+        assert(threw);
+
+        //Spawns are checked before they reach a world: a huge id and a duplicate are refused
+        //with an error reply, and the encounter keeps being served
+        WireMessage bad;
+        bad.kind = WireKind::Spawn;
+        bad.tag = 1000;
+        bad.entity = Entity{UINT32_MAX, 100, 0, 10, {}, {}};
+        client.Send(bad);
+        bad.tag = 1001;
+        bad.entity = hero;
+        client.Send(bad);
+        WireMessage after;
+        after.kind = WireKind::Tick;
+        after.tag = 1002;
+        client.Send(after);
+        const WireMessage hugeId = client.Receive(), duplicate = client.Receive(), tick = client.Receive();
+        assert(!hugeId.ok && hugeId.tag == 1000 && hugeId.text == "Entity id 4294967295 is above the limit of 16777215");
+        assert(!duplicate.ok && duplicate.tag == 1001 && duplicate.text == "Entity already exists: 1");
+        assert(tick.ok && tick.tag == 1002);
+
+        server.Stop();
+        loop.join();
+        assert(server.Served() == sent.size() + 3);
+    }
+
+    // Case: resolver_server stops reading from a client that pipelines without taking replies
+    {
+        const std::string socket = "resolver_tests.sock";
+        ServerOptions options{socket, 1};
+        options.maxInFlight = 8;
+        options.maxOutbox = 16 * 1024;
+        ResolverServer server(db, options);
+        std::thread loop([&] { server.Run(); });
+
+        //Traced ticks over a crowd of burning entities answer a few bytes with kilobytes
+        ResolverClient client(socket);
+        WireMessage m;
+        m.kind = WireKind::Spawn;
+        for(EntityId id = 1; id <= 20; ++id) {
+            m.tag = id;
+            m.entity = Entity{id, 1000000000, 0, 10, 0, {{db.FindStatus("burning"), 1, 1000000}}};
+            client.Send(m);
+        }
+        const uint32_t ticks = 2000;
+        m.kind = WireKind::Tick;
+        m.wantTrace = true;
+        for(uint32_t i = 0; i < ticks; ++i) {
+            m.tag = 100 + i;
+            client.Send(m);
+        }
+        client.Flush();
+
+        //Served stops growing once the socket buffers and the capped outbox are full
+        uint64_t served = 0;
+        do {
+            served = server.Served();
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        } while(server.Served() != served);
+        assert(served < ticks / 2);
+
+        for(uint32_t i = 0; i < 20 + ticks; ++i) {
+            const WireMessage r = client.Receive();
+            assert(r.ok && r.tag == (i < 20 ? i + 1 : 100 + i - 20));
+            assert(i < 20 || r.text.size() > 1000);
+        }
+        server.Stop();
+        loop.join();
+        assert(server.Served() == 20 + ticks);
+    }
+
+    // Case: profiling probes time each phase once per call, and compile out to nothing
+    {
+        static_assert(kProfilingEnabled || std::is_empty_v<ProfileProbe>);
+        World w;
+        w.Spawn(Entity{1, 100, 0, 10, db.InternTag("Player"), {}});
+        w.Spawn(Entity{2, 100, 0, 10, db.InternTag("Enemy"), {}});
+        w.AddStatus(db, w.Get(2), "burning", 2, 1);
+
+        ResetProfile();
+        const std::string text = resolver.Resolve(w, {db.FindAbility("firebolt"), 1, {2}}).ToString();
+        ResolutionTrace trace;
+        w.TickTurnStart(db, trace);
+
+        using P = ProfilePhase;
+        const auto profile = CollectProfile();
+        const uint64_t once = kProfilingEnabled ? 1 : 0;
+        for(P p : {P::Resolve, P::TargetValidation, P::EvalAmount, P::DealHooks, P::TakeHooks, P::Mitigation,
+                   P::StatusApply, P::TraceFormat, P::Tick, P::TickCollect, P::TickRows, P::TickReschedule}) {
+            assert(profile[(size_t)p].count == once);
+        }
+        assert(profile[(size_t)P::StatusRemove].count == 0);
+        const PhaseProfile& resolve = profile[(size_t)P::Resolve];
+        assert(resolve.totalNs >= profile[(size_t)P::EvalAmount].totalNs + profile[(size_t)P::Mitigation].totalNs);
+        assert(resolve.minNs <= resolve.PercentileNs(0.99) && resolve.PercentileNs(0.99) <= resolve.maxNs);
+
+        std::stringstream json, chrome;
+        WriteProfileJson(json);
+        WriteChromeTrace(chrome);
+        const auto phases = nlohmann::json::parse(json.str())["phases"];
+        const auto spans = nlohmann::json::parse(chrome.str())["traceEvents"];
+        assert(phases.size() == kProfilePhases && phases[0]["name"] == "resolve" && phases[0]["count"] == once);
+        assert(spans.size() == 12 * once);
+    }
+
+    // Case: traces streamed into a sink match the buffered rendering byte for byte
+    {
+        const StatusHandle burning = db.FindStatus("burning");
+        World buffered;
+        buffered.Spawn(Entity{1, 100, 0, 10, db.InternTag("Player"), {}});
+        for(EntityId id = 2; id <= 1200; ++id) buffered.Spawn(Entity{id, 1000, 0, 10, db.InternTag("Enemy"), {{burning, 1 + (int)(id % 3), 2}}});
+        World streamed = buffered;
+
+        ThreadPool pool(4);
+        ResolutionTrace a;
+        StringTraceSink memory;
+        ResolutionTrace b;
+        b.sink = &memory;
+        for(const char* ability : {"firebolt", "strike", "firebolt"}) {
+            resolver.Resolve(buffered, {db.FindAbility(ability), 1, {2}}, a);
+            resolver.Resolve(streamed, {db.FindAbility(ability), 1, {2}}, b);
+        }
+        buffered.TickTurnStart(db, a);
+        streamed.TickTurnStart(db, b, &pool);     // parallel chunks stream in chunk order
+        assert(b.events.empty() && streamed.StateHash() == buffered.StateHash());
+        AssertGolden("streamed_trace", memory.text, a.ToString());
+
+        const std::string path = "resolver_tests_trace.txt";
+        {
+            FileTraceSink file(path);
+            a.WriteTo(file);
+        }
+        std::ifstream in(path, std::ios::binary);
+        assert(std::string(std::istreambuf_iterator<char>(in), {}) == memory.text);
+        in.close();
+        std::filesystem::remove(path);
+
+        NullTraceSink null;
+        ResolutionTrace c;
+        c.sink = &null;
+        resolver.Resolve(streamed, {db.FindAbility("firebolt"), 1, {2}}, c);
+        assert(c.events.empty());
+
+        for(float v : {0.f, -0.f, 0.005f, 0.015f, 2.675f, -1.125f, 21.6f, 123456.789f, 3.4e38f}) {
+            char expected[64];
+            std::snprintf(expected, sizeof(expected), "%.2f", (double)v);
+            assert(FmtFloat(v) == expected);
+        }
+        assert(FmtFloat(1.0f / 3.0f, 5) == "0.33333");
+    }
+
+    // Case: tags past the 63 masked ones share the overflow bit and are confirmed by name
+    {
+        namespace fs = std::filesystem;
+        const fs::path dir = "resolver_tests_tags";
+        fs::remove_all(dir);
+        fs::create_directory(dir);
+        std::string filler;
+        for(int t = 0; t < 63; ++t) filler += (t ? ", \"t" : "\"t") + std::to_string(t) + "\"";
+        std::ofstream(dir / "00_statuses.json") <<
+            R"({"statuses": [{"id": "filler", "tags": [)" << filler << R"(]},)"
+            R"( {"id": "marked", "tags": ["t64"]}, {"id": "hexed", "tags": ["t65"]},)"
+            R"( {"id": "amp", "hooks": {"OnBeforeDealDamage": [)"
+            R"(  {"when": {"abilityHasTag": "t66"}, "modify": {"multiplier": 2}},)"
+            R"(  {"when": {"abilityHasTag": "t67"}, "modify": {"multiplier": 10}},)"
+            R"(  {"when": {"targetHasStatusTag": "t64"}, "modify": {"addFlat": 100}}]}}]})";
+        std::ofstream(dir / "10_abilities.json") <<
+            R"({"abilities": [)"
+            R"( {"id": "zap", "tags": ["t66"], "targeting": {"mode": "SingleEnemy"}, "effects": [)"
+            R"(  {"type": "Damage", "damageType": "Physical", "amount": {"base": 10, "scalesWith": "Power", "scale": 0}}]},)"
+            R"( {"id": "zap_all", "tags": ["t66"], "targeting": {"mode": "AllEnemies"}, "effects": [)"
+            R"(  {"type": "Damage", "damageType": "Physical", "amount": {"base": 10, "scalesWith": "Power", "scale": 0}}]},)"
+            R"( {"id": "purge", "targeting": {"mode": "SingleEnemy"}, "effects": [)"
+            R"(  {"type": "RemoveStatusByTag", "tag": "t65", "maxRemoved": 5}]}]})";
+        const Db tagged = DbLoader::LoadFromDirectory(dir.string());
+        fs::remove_all(dir);
+        assert(tagged.tagNames.size() == 67);
+        assert(tagged.TagMaskOf("t62") == TagMask{1} << 62 && tagged.TagMaskOf("t64") == kOverflowTag);
+        assert(tagged.TagMaskOf("t67") == kOverflowTag && tagged.GetStatus(tagged.FindStatus("hexed")).tagMask == kOverflowTag);
+
+        const Resolver r(tagged);
+        World w;
+        for(EntityId id = 1; id <= 3; ++id) w.Spawn(Entity{id, 1000, 0, 10, {}, {}});
+        w.AddStatus(tagged, w.Get(1), "amp", 9, 1);
+        w.AddStatus(tagged, w.Get(2), "hexed", 9, 1);
+        w.AddStatus(tagged, w.Get(3), "marked", 9, 1);
+
+        //t66 doubles; t67 and the target's t64 share its bit but are absent, so they do not fire
+        r.Resolve(w, {tagged.FindAbility("zap"), 1, {2}}, TraceLevel::Off);
+        assert(w.Get(2).hp == 980);
+        r.Resolve(w, {tagged.FindAbility("zap_all"), 1, {2, 3}}, TraceLevel::Off);
+        assert(w.Get(2).hp == 960 && w.Get(3).hp == 880);     // 10 * 2 + 100 against the marked target
+
+        w.AddStatus(tagged, w.Get(2), "marked", 9, 1);
+        const auto purged = r.Resolve(w, {tagged.FindAbility("purge"), 1, {2}});
+        assert(w.Get(2).statuses.size() == 1 && w.Get(2).statuses[0].status == tagged.FindStatus("marked"));
+        assert(purged.ToString().find("Remove Status Tag =t65 removed=1") != std::string::npos);
+    }
+
+    // Case: abilities are lowered into contiguous ops with their targeting rules precomputed
+    {
+        const AbilityHandle fb = db.FindAbility("firebolt");
+        const AbilityCode& code = db.GetAbilityCode(fb);
+        const auto ops = db.Ops(code);
+        assert(ops.size() == 2 && ops.data() == db.abilityOps.data() + code.firstOp);
+        assert(ops[0].code == EffectOpCode::Damage && ops[0].damageType == DamageType::Fire);
+        assert(ops[0].base == 12.f && ops[0].scale == 0.6f && ops[0].scalesWith == Stat::Power);
+        assert(ops[1].code == EffectOpCode::ApplyStatus && ops[1].status == db.FindStatus("burning"));
+        assert(ops[1].duration == 2 && ops[1].stacks == 1 && code.applyStatusOps == 1);
+        assert(code.minTargets == 1 && code.maxTargets == 1 && !code.area && code.tagMask == db.GetAbility(fb).tagMask);
+        const AbilityCode& strikeCode = db.GetAbilityCode(db.FindAbility("strike"));
+        assert(strikeCode.firstOp == code.firstOp + code.opCount && strikeCode.applyStatusOps == 0);
+
+        Db content = db;
+        AbilityDef focus;
+        focus.id = "focus";
+        focus.targeting.mode = TargetMode::Self;
+        AbilityEffectDef heal{AbilityEffectDef::Kind::Heal};
+        heal.amount = {5, Stat::Power, 1};
+        AbilityEffectDef cleanse{AbilityEffectDef::Kind::RemoveStatusByTag};
+        cleanse.tag = "Debuff";
+        cleanse.maxRemoved = 1;
+        focus.effects = {heal, cleanse};
+        const AbilityHandle self = content.AddAbility(focus);
+        const AbilityCode& selfCode = content.GetAbilityCode(self);
+        assert(selfCode.casterOnly && selfCode.minTargets == 1 && selfCode.maxTargets == 1);
+        assert(content.Ops(selfCode)[1].code == EffectOpCode::RemoveByTag && content.Ops(selfCode)[1].tagMask == content.InternTag("Debuff"));
+
+        const Resolver lowered(content);
+        World w;
+        w.Spawn(Entity{1, 50, 0, 10, {}, {}});
+        w.Spawn(Entity{2, 100, 0, 10, {}, {}});
+        assert(lowered.Resolve(w, {self, 1, {2}}).ToString().find("Error: Self ability") != std::string::npos);
+        assert(w.Get(1).hp == 50 && w.Get(2).hp == 100);
+        const auto cleansed = lowered.Resolve(w, {self, 1, {1}});
+        assert(w.Get(1).hp == 65);          // 5 + 10 power
+
+        //Traces name removed tags by their interned index, so they outlive the def that removed them
+        AbilityDef purge = content.GetAbility(self);
+        purge.effects = {purge.effects[1], purge.effects[1], purge.effects[1]};
+        purge.effects[0].tag = "Buff";
+        content.ReplaceAbility(self, std::move(purge));
+        assert(cleansed.ToString().find("Effect: Remove Status Tag =Debuff removed=0 target=1") != std::string::npos);
+        assert(lowered.Resolve(w, {fb, 1, {2, 1}}).ToString().find("Error: Single enemy") != std::string::npos);
+
+        //A replaced def keeps its handle and is what resolution runs from then on
+        AbilityDef weaker = content.GetAbility(fb);
+        weaker.effects.pop_back();
+        weaker.effects[0].amount.base = 2.f;
+        const uint64_t stamp = content.stamp.value;
+        content.ReplaceAbility(fb, weaker);
+        assert(content.stamp.value != stamp && content.GetAbilityCode(fb).firstOp == code.firstOp);
+        assert(content.Ops(content.GetAbilityCode(fb)).size() == 1 && content.GetAbilityCode(fb).applyStatusOps == 0);
+        Resolver(content).Resolve(w, {fb, 1, {2}}, TraceLevel::Off);
+        assert(w.Get(2).hp == 92 && w.Get(2).statuses.empty());    // (2 + 6) * 1.0, no burning
+
+        //Replacements that outgrow their block move it; abandoned blocks are compacted away
+        AbilityDef longer = content.GetAbility(fb);
+        longer.effects = {longer.effects[0], longer.effects[0], longer.effects[0], longer.effects[0]};
+        for(int reload = 0; reload < 200; ++reload) content.ReplaceAbility(fb, reload % 2 ? weaker : longer);
+        size_t live = 0;
+        for(const auto& c : content.abilityCode) live += c.opCount;
+        assert(live + content.opGarbage == content.abilityOps.size() && content.abilityOps.size() <= 2 * live + 64);
+        content.CompactOps();
+        assert(content.abilityOps.size() == live && content.opGarbage == 0);
+        assert(content.Ops(content.GetAbilityCode(fb)).size() == 1 && content.GetAbilityCode(self).opCount == 3);
+        assert(content.Ops(content.GetAbilityCode(self))[0].tag == content.tagIndex.at("Buff"));
+
+        bool threw = false;
+        weaker.id = "renamed";
+        try { content.ReplaceAbility(fb, weaker); } catch(const std::runtime_error&) { threw = true; }
+        assert(threw);
+        threw = false;
+        try { content.GetAbilityCode(99); } catch(const std::runtime_error&) { threw = true; }
+        assert(threw);
+    }
+
+    // Case: resolver_sim encounters are exact, reproducible per seed, and independent of thread count
+    {
+        //Strike does 10 + 10 * 0.5 = 15; entity 2 dies on turn 2 with 5 of the second hit wasted
+        const EncounterSpec duel = ParseEncounterSpec(db, R"({"maxTurns": 10, "combatants": [)"
+            R"({"id": 1, "team": 0, "hp": 100, "armor": 0, "power": 10, "abilities": ["strike"]},)"
+            R"({"id": 2, "team": 1, "hp": 20, "armor": 0, "power": 10, "abilities": ["strike"]}]})");
+        SimOptions few;
+        few.encounters = 3;
+        const SimReport fight = Simulate(db, duel, few);
+        assert(fight.encounters == 3 && fight.resolves == 9 && fight.ticks == 6);
+        assert(fight.wins == std::vector<uint64_t>({3, 0}) && fight.draws == 0 && fight.turns.min == 2 && fight.turns.max == 2);
+        assert(fight.combatants[0].damageDealt.sum == 60 && fight.combatants[1].damageTaken.max == 20);
+        assert(fight.combatants[0].damageTaken.Mean() == 15.0 && fight.combatants[0].turnsToDeath.count == 0);
+        assert(fight.combatants[1].turnsToDeath.count == 3 && fight.combatants[1].turnsToDeath.Percentile(0.5) == 2);
+        assert(fight.combatants[0].aliveTurns == 6 && fight.combatants[1].aliveTurns == 3);
+
+        const EncounterSpec spec = LoadEncounterSpec(db, "data/encounter.json");
+        assert(spec.combatants.size() == 3 && spec.combatants[1].weights == std::vector<uint32_t>({3, 1}));
+        SimOptions opts;
+        opts.encounters = 3000;
+        opts.seed = 7;
+        const SimReport serial = Simulate(db, spec, opts);
+        ThreadPool pool(4);
+        opts.pool = &pool;
+        const SimReport parallel = Simulate(db, spec, opts);
+        auto same = [](const SimReport& a, const SimReport& b) {
+            if(a.resolves != b.resolves || a.ticks != b.ticks || a.wins != b.wins || a.draws != b.draws) return false;
+            if(a.turns.buckets != b.turns.buckets) return false;
+            for(size_t j = 0; j < a.combatants.size(); ++j) {
+                const auto& x = a.combatants[j];
+                const auto& y = b.combatants[j];
+                if(x.damageDealt.buckets != y.damageDealt.buckets || x.damageTaken.sum != y.damageTaken.sum) return false;
+                if(x.turnsToDeath.buckets != y.turnsToDeath.buckets || x.statusTurns != y.statusTurns) return false;
+            }
+            return true;
+        };
+        assert(serial.encounters == 3000 && same(serial, parallel));
+        const StatusHandle shielded = db.FindStatus("shielded");
+        assert(serial.combatants[1].Uptime(shielded) > 0.0 && serial.combatants[1].Uptime(shielded) < 1.0);
+        assert(serial.combatants[0].Uptime(shielded) == 0.0);
+        opts.seed = 8;
+        assert(!same(serial, Simulate(db, spec, opts)));
+
+        std::ostringstream out;
+        WriteSimReportJson(db, spec, serial, out);
+        const auto doc = nlohmann::json::parse(out.str());
+        assert(doc["encounters"] == 3000 && doc["combatants"].size() == 3);
+        assert(doc["combatants"][1]["status_uptime"].contains("shielded"));
+
+        //Histograms widen by powers of two and merge to what one pass would have built
+        SimDistribution whole, left, right;
+        for(uint64_t v = 0; v < 5000; ++v) {
+            whole.Add(v * 3);
+            (v % 2 ? left : right).Add(v * 3);
+        }
+        left.Merge(right);
+        assert(whole.bucketWidth == 16 && left.bucketWidth == whole.bucketWidth && left.buckets == whole.buckets);
+        assert(whole.Percentile(1.0) == 14997 && whole.Percentile(0.5) == left.Percentile(0.5));
+
+        auto rejects = [&](const char* text) {
+            try { Simulate(db, ParseEncounterSpec(db, text), few); } catch(const std::runtime_error&) { return true; }
+            return false;
+        };
+        assert(rejects(R"({"combatants": [{"id": 1, "abilities": ["strike"]}, {"id": 2, "abilities": ["strike"]}]})"));
+        assert(rejects(R"({"combatants": [{"id": 1, "abilities": ["nope"]}, {"id": 2, "team": 1, "abilities": ["strike"]}]})"));
+        assert(rejects(R"({"combatants": [{"id": 1, "abilities": []}, {"id": 2, "team": 1, "abilities": ["strike"]}]})"));
+        assert(rejects(R"({"combatants": [{"id": 1, "abilities": ["strike"]}, {"id": 1, "team": 1, "abilities": ["strike"]}]})"));
+        assert(rejects(R"({"combatants": [{"id": 1, "abilities": [{"id": "strike", "weight": 1}, "firebolt"]}]})"));
+        assert(rejects(R"({"combatants": 3})"));
+    }
+
     std::cout << "All tests passed.\n";
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include "resolver/DbLoader.h"
+#include "resolver/Server.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <thread>
+
+// Load generator for resolver_server. Each connection runs on its own thread, spawns its
+// encounters, then keeps up to --depth requests in flight until it has sent --requests of
+// them: random abilities of the content, with a tick after every --tick-every resolves in
+// an encounter. Reports requests/sec and latency percentiles over all connections.
+//
+//   resolver_load <socket> <abilities.json> <statuses.json> [options]
+//   resolver_load <socket> --snapshot <content.resdb> [options]
+//
+//   --connections C   client connections (4)
+//   --encounters E    encounters per connection (16)
+//   --entities M      entities per encounter (8)
+//   --requests R      requests per connection (100000)
+//   --depth D         requests in flight per connection (32)
+//   --tick-every K    resolves per encounter between ticks, 0 for none (16)
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    struct LoadOptions {
+        uint32_t connections = 4;
+        uint32_t encounters = 16;
+        uint32_t entities = 8;
+        uint64_t requests = 100000;
+        uint32_t depth = 32;
+        uint32_t tickEvery = 16;
+    };
+
+    struct ConnectionResult {
+        std::vector<double> latencies;  // microseconds, one per request
+        uint64_t errors = 0;
+        std::string firstError;
+        std::string failure;            // set when the connection itself failed
+    };
+
+    uint32_t XorShift(uint32_t& s) {
+        s ^= s << 13;
+        s ^= s >> 17;
+        s ^= s << 5;
+        return s;
+    }
+
+    void RunConnection(const res::Db& db, const std::string& socket, const LoadOptions& opts, uint32_t index,
+                       ConnectionResult& result) {
+        using namespace res;
+        ResolverClient client(socket);
+        const uint32_t firstEncounter = index * opts.encounters;
+
+        auto expectOk = [&](const WireMessage& reply) {
+            if (!reply.ok) throw std::runtime_error("setup failed: " + reply.text);
+        };
+
+        WireMessage m;
+        m.kind = WireKind::Spawn;
+        for (uint32_t e = 0; e < opts.encounters; ++e) {
+            for (uint32_t id = 1; id <= opts.entities; ++id) {
+                m.encounter = firstEncounter + e;
+                m.entity = Entity{id, 1'000'000, 0, 10, 0, {}};
+                client.Send(m);
+            }
+        }
+        for (uint64_t i = 0; i < (uint64_t)opts.encounters * opts.entities; ++i) expectOk(client.Receive());
+
+        uint32_t rng = 0x9e3779b9u ^ (index + 1) * 2654435761u;
+        std::vector<uint32_t> resolvesSinceTick(opts.encounters, 0);
+        std::vector<Clock::time_point> sentAt(opts.requests);
+        uint64_t issued = 0;
+
+        auto issue = [&] {
+            const uint32_t e = XorShift(rng) % opts.encounters;
+            m.tag = issued;
+            m.encounter = firstEncounter + e;
+            if (opts.tickEvery != 0 && resolvesSinceTick[e] == opts.tickEvery) {
+                m.kind = WireKind::Tick;
+                resolvesSinceTick[e] = 0;
+            } else {
+                m.kind = WireKind::Resolve;
+                ++resolvesSinceTick[e];
+                const AbilityHandle ability = XorShift(rng) % (uint32_t)db.abilities.size();
+                const EntityId caster = 1 + XorShift(rng) % opts.entities;
+                EntityId target = caster;
+                if (db.GetAbility(ability).targeting.mode != TargetMode::Self && opts.entities > 1)
+                    target = 1 + (caster + XorShift(rng) % (opts.entities - 1)) % opts.entities;
+                m.request.ability = ability;
+                m.request.caster = caster;
+                m.request.targets.assign(1, target);
+            }
+            sentAt[issued++] = Clock::now();
+            client.Send(m);
+        };
+
+        while (issued < std::min<uint64_t>(opts.depth, opts.requests)) issue();
+        result.latencies.reserve(opts.requests);
+        for (uint64_t received = 0; received < opts.requests; ++received) {
+            const WireMessage reply = client.Receive();
+            result.latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sentAt[reply.tag]).count());
+            if (!reply.ok && result.errors++ == 0) result.firstError = reply.text;
+            if (issued < opts.requests) issue();
+        }
+
+        m.kind = WireKind::EndEncounter;
+        for (uint32_t e = 0; e < opts.encounters; ++e) {
+            m.encounter = firstEncounter + e;
+            client.Send(m);
+        }
+        for (uint32_t e = 0; e < opts.encounters; ++e) expectOk(client.Receive());
+    }
+
+    double Percentile(const std::vector<double>& sorted, double p) {
+        if (sorted.empty()) return 0.0;
+        return sorted[std::min(sorted.size() - 1, (size_t)(p * (double)sorted.size()))];
+    }
+
+}
+
+int main(int argc, char** argv) {
+    using namespace res;
+
+    auto usage = [] {
+        std::cerr << "usage: resolver_load <socket> <abilities.json> <statuses.json> [options]\n"
+                     "       resolver_load <socket> --snapshot <content.resdb> [options]\n"
+                     "options: --connections C --encounters E --entities M --requests R --depth D --tick-every K\n";
+        return 2;
+    };
+
+    std::vector<const char*> positional;
+    const char* snapshot = nullptr;
+    LoadOptions opts;
+    for (int i = 1; i < argc; ++i) {
+        auto number = [&] { return std::strtoull(argv[++i], nullptr, 10); };
+        const bool hasValue = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--snapshot") && hasValue) snapshot = argv[++i];
+        else if (!std::strcmp(argv[i], "--connections") && hasValue) opts.connections = (uint32_t)number();
+        else if (!std::strcmp(argv[i], "--encounters") && hasValue) opts.encounters = (uint32_t)number();
+        else if (!std::strcmp(argv[i], "--entities") && hasValue) opts.entities = (uint32_t)number();
+        else if (!std::strcmp(argv[i], "--requests") && hasValue) opts.requests = number();
+        else if (!std::strcmp(argv[i], "--depth") && hasValue) opts.depth = (uint32_t)number();
+        else if (!std::strcmp(argv[i], "--tick-every") && hasValue) opts.tickEvery = (uint32_t)number();
+        else positional.push_back(argv[i]);
+    }
+    if (positional.size() != (snapshot ? 1u : 3u)) return usage();
+    if (opts.connections == 0 || opts.encounters == 0 || opts.entities == 0 || opts.depth == 0) return usage();
+    const std::string socket = positional[0];
+
+    try {
+        const Db db = snapshot ? DbLoader::LoadFromSnapshot(snapshot)
+                               : DbLoader::LoadFromFiles(positional[1], positional[2]);
+        if (db.abilities.empty()) throw std::runtime_error("content has no abilities");
+
+        std::vector<ConnectionResult> results(opts.connections);
+        std::vector<std::thread> threads;
+        const auto t0 = Clock::now();
+        for (uint32_t c = 0; c < opts.connections; ++c) {
+            threads.emplace_back([&, c] {
+                try {
+                    RunConnection(db, socket, opts, c, results[c]);
+                } catch (const std::exception& e) {
+                    results[c].failure = e.what();
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+        const double secs = std::chrono::duration<double>(Clock::now() - t0).count();
+
+        std::vector<double> latencies;
+        uint64_t errors = 0;
+        for (const auto& r : results) {
+            if (!r.failure.empty()) throw std::runtime_error(r.failure);
+            latencies.insert(latencies.end(), r.latencies.begin(), r.latencies.end());
+            errors += r.errors;
+        }
+        std::sort(latencies.begin(), latencies.end());
+
+        std::cout << latencies.size() << " requests over " << opts.connections << " connections in " << secs * 1e3
+                  << " ms: " << (secs > 0 ? (double)latencies.size() / secs : 0.0) << " req/s\n";
+        std::cout << "latency us: p50 " << Percentile(latencies, 0.50) << ", p99 " << Percentile(latencies, 0.99)
+                  << ", max " << (latencies.empty() ? 0.0 : latencies.back()) << "\n";
+        if (errors > 0) {
+            const auto failed = std::find_if(results.begin(), results.end(), [](const auto& r) { return r.errors > 0; });
+            std::cout << errors << " requests failed, first: " << failed->firstError << "\n";
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "resolver_load: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,27 @@
+#include "resolver/DbLoader.h"
+#include <exception>
+#include <iostream>
+
+// Compiles the JSON content into a binary Db snapshot for DbLoader::LoadFromSnapshot.
+int main(int argc, char** argv) {
+    using namespace res;
+
+    if (argc != 4) {
+        std::cerr << "usage: resolver_pack <abilities.json> <statuses.json> <out.resdb>\n";
+        return 2;
+    }
+
+    try {
+        const Db db = DbLoader::LoadFromFiles(argv[1], argv[2]);
+        DbLoader::WriteSnapshot(db, argv[3]);
+
+        //Read it back so a bad pack fails here rather than in a worker
+        const Db check = DbLoader::LoadFromSnapshot(argv[3]);
+        std::cout << "packed " << check.abilities.size() << " abilities, " << check.statuses.size()
+                  << " statuses, " << check.tagNames.size() << " tags into " << argv[3] << "\n";
+    } catch (const std::exception& e) {
+        std::cerr << "resolver_pack: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include "resolver/DbLoader.h"
+#include "resolver/Server.h"
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+// Serves resolves and ticks for many encounters over a Unix domain socket; see Server.h.
+//
+//   resolver_server <socket> <abilities.json> <statuses.json> [--workers N]
+//   resolver_server <socket> --snapshot <content.resdb> [--workers N]
+//
+// Runs until SIGINT or SIGTERM.
+
+static res::ResolverServer* g_server = nullptr;
+
+static void OnSignal(int) {
+    if (g_server) g_server->Stop();
+}
+
+int main(int argc, char** argv) {
+    using namespace res;
+
+    auto usage = [] {
+        std::cerr << "usage: resolver_server <socket> <abilities.json> <statuses.json> [--workers N]\n"
+                     "       resolver_server <socket> --snapshot <content.resdb> [--workers N]\n";
+        return 2;
+    };
+
+    std::vector<const char*> positional;
+    const char* snapshot = nullptr;
+    ServerOptions opts;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--snapshot") && i + 1 < argc) snapshot = argv[++i];
+        else if (!std::strcmp(argv[i], "--workers") && i + 1 < argc) opts.workers = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else positional.push_back(argv[i]);
+    }
+    if (positional.size() != (snapshot ? 1u : 3u)) return usage();
+    opts.socketPath = positional[0];
+
+    try {
+        const Db db = snapshot ? DbLoader::LoadFromSnapshot(snapshot)
+                               : DbLoader::LoadFromFiles(positional[1], positional[2]);
+        ResolverServer server(db, opts);
+        g_server = &server;
+        std::signal(SIGINT, OnSignal);
+        std::signal(SIGTERM, OnSignal);
+
+        std::cout << "serving " << db.abilities.size() << " abilities, " << db.statuses.size() << " statuses on "
+                  << opts.socketPath << " with " << (opts.workers ? opts.workers : 1) << " workers" << std::endl;
+        server.Run();
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+        g_server = nullptr;
+        std::cout << "served " << server.Served() << " requests\n";
+    } catch (const std::exception& e) {
+        std::cerr << "resolver_server: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}